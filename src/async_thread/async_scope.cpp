@@ -0,0 +1,41 @@
+#include "async_scope.h"
+
+namespace {
+DetachedTask RunInScope(AsyncScope::Ticket ticket, Task<void> task)
+{
+    if (!ticket.IsCancelled()) {
+        // the task frame is freed before the ticket leaves, so nothing of it is left when Join returns
+        auto local = std::move(task);
+        co_await std::move(local);
+    }
+}
+}  // namespace
+
+void AsyncScope::Spawn(Task<void> task)
+{
+    RunInScope(GetTicket(), std::move(task));
+}
+
+void AsyncScope::Leave()
+{
+    // most tickets leave without the lock, only the one which may be the last takes it
+    uint64_t pending = _pending.load(std::memory_order_relaxed);
+    while (pending > 1) {
+        if (_pending.compare_exchange_weak(pending, pending - 1, std::memory_order_release,
+                                           std::memory_order_relaxed)) {
+            return;
+        }
+    }
+
+    // Join only returns after it has got the lock, so the scope is still there while it is notified
+    std::lock_guard<std::mutex> lock {_lock};
+    if (_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        _joined.notify_all();
+    }
+}
+
+void AsyncScope::Join()
+{
+    std::unique_lock<std::mutex> lock {_lock};
+    _joined.wait(lock, [this]() { return _pending.load(std::memory_order_acquire) == 0; });
+}
@@ -0,0 +1,135 @@
+#ifndef ASYNC_SCOPE_H
+#define ASYNC_SCOPE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include "cancellation.h"
+#include "task.h"
+#include "thread_pool/thread_pool.h"
+
+/**
+ * structured concurrency: work started in a scope can not outlive it. every piece of work holds a Ticket of the
+ * scope, and Join (also run by the destructor) returns once all tickets are gone, so a scope going out of scope
+ * is a deterministic point where everything it started has finished, with no sleeping or polling.
+ * a ticket is released when the work is done or when it is dropped without running, e.g. a task left in a
+ * stopped pool or the callback of a channel which is never sent, so Join never waits for work which can not come.
+ */
+class AsyncScope {
+public:
+    // copies enter the scope and destruction leaves it, the scope counts the live tickets
+    class Ticket {
+    public:
+        ~Ticket()
+        {
+            if (_scope != nullptr) {
+                _scope->Leave();
+            }
+        }
+
+        Ticket(const Ticket& other) : _scope(other._scope)
+        {
+            if (_scope != nullptr) {
+                _scope->Enter();
+            }
+        }
+
+        Ticket(Ticket&& other) noexcept : _scope(std::exchange(other._scope, nullptr))
+        {}
+
+        Ticket& operator=(const Ticket&) = delete;
+        Ticket& operator=(Ticket&&) = delete;
+
+        // work which has not started yet should be skipped, running work should stop early if it can
+        bool IsCancelled() const
+        {
+            return (_scope != nullptr) && _scope->IsCancelled();
+        }
+
+    private:
+        friend class AsyncScope;
+
+        explicit Ticket(AsyncScope* scope) : _scope(scope)
+        {
+            _scope->Enter();
+        }
+
+        AsyncScope* _scope;
+    };
+
+    AsyncScope() = default;
+    ~AsyncScope()
+    {
+        Join();
+    }
+
+    AsyncScope(const AsyncScope&) = delete;
+    AsyncScope& operator=(const AsyncScope&) = delete;
+    AsyncScope(const AsyncScope&&) = delete;
+    AsyncScope& operator=(const AsyncScope&&) = delete;
+
+    // should be called before Join, or by work of the scope itself
+    Ticket GetTicket()
+    {
+        return Ticket(this);
+    }
+
+    // run func() on executor as work of the scope, false if executor refuses it, func is not run then
+    template<typename F>
+    bool Spawn(ThreadPool& executor, F&& func);
+
+    // start task now as work of the scope, nobody awaits it, so an exception escaping it terminates
+    void Spawn(Task<void> task);
+
+    /**
+     * work which has not started is skipped from now on, running work sees it by Ticket::IsCancelled or by
+     * the callbacks registered on GetToken
+     */
+    void Cancel()
+    {
+        (void)_cancellation.Cancel();
+    }
+
+    bool IsCancelled() const
+    {
+        return _cancellation.IsCancelled();
+    }
+
+    // for producers started by work of the scope, and for sources linked to it
+    CancellationToken GetToken() const
+    {
+        return _cancellation.GetToken();
+    }
+
+    // wait until all work of the scope is done, it can be called more than once
+    void Join();
+
+private:
+    void Enter()
+    {
+        _pending.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void Leave();
+
+    std::atomic<uint64_t> _pending {0};
+    CancellationSource _cancellation;
+    std::mutex _lock;
+    std::condition_variable _joined;
+};
+
+template<typename F>
+bool AsyncScope::Spawn(ThreadPool& executor, F&& func)
+{
+    auto task = [ticket = GetTicket(), func = std::forward<F>(func)]() mutable {
+        if (!ticket.IsCancelled()) {
+            func();
+        }
+    };
+    // a refused task leaves the scope with its ticket, the caller may try again later
+    return executor.AddTask(std::move(task)).valid();
+}
+
+#endif // ASYNC_SCOPE_H
@@ -0,0 +1,202 @@
+#ifndef ASYNC_STREAM_H
+#define ASYNC_STREAM_H
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+/**
+ * bounded stream of items from producer coroutines to one consumer coroutine, e.g. the pages of a scan.
+ * a producer waits in co_await Push while the buffer is full and the consumer waits in co_await Next while it is
+ * empty, so a fast producer is held back instead of the whole result being buffered. no thread waits for that:
+ * the side which brings an item or makes room resumes the waiting side on its own thread.
+ * items are moved in and out, never copied.
+ *
+ *     while (auto item = co_await stream.Next()) {
+ *         ...
+ *     }
+ */
+template<typename T>
+class AsyncStream {
+public:
+    // Push queues the item at once, the awaiter only waits until the item is within capacity
+    class PushAwaiter {
+    public:
+        PushAwaiter(AsyncStream& stream, uint64_t seq, bool accepted) :
+            _stream(stream), _seq(seq), _accepted(accepted)
+        {}
+
+        bool await_ready() noexcept
+        {
+            return !_accepted || _stream.Fits(_seq);
+        }
+
+        bool await_suspend(std::coroutine_handle<> handle)
+        {
+            std::lock_guard<std::mutex> lock {_stream._lock};
+            if (_stream._closed || _stream.Fits(_seq)) {
+                return false;
+            }
+            _stream._waitingProducers.emplace_back(_seq, handle);
+            return true;
+        }
+
+        // false if the stream is closed, the producer should stop then
+        bool await_resume()
+        {
+            std::lock_guard<std::mutex> lock {_stream._lock};
+            return _accepted && !_stream._closed;
+        }
+
+    private:
+        AsyncStream& _stream;
+        uint64_t _seq;
+        bool _accepted;
+    };
+
+    class NextAwaiter {
+    public:
+        explicit NextAwaiter(AsyncStream& stream) : _stream(stream)
+        {}
+
+        bool await_ready() noexcept
+        {
+            return false;
+        }
+
+        bool await_suspend(std::coroutine_handle<> handle)
+        {
+            std::lock_guard<std::mutex> lock {_stream._lock};
+            if (!_stream._buffer.empty() || _stream._closed) {
+                return false;
+            }
+            _stream._consumer = handle;
+            return true;
+        }
+
+        // the next item, nullopt once the stream is closed and all items are taken
+        std::optional<T> await_resume()
+        {
+            return _stream.Take();
+        }
+
+    private:
+        AsyncStream& _stream;
+    };
+
+    explicit AsyncStream(size_t capacity) : _capacity((capacity == 0) ? 1 : capacity)
+    {}
+
+    AsyncStream(const AsyncStream&) = delete;
+    AsyncStream& operator=(const AsyncStream&) = delete;
+    AsyncStream(const AsyncStream&&) = delete;
+    AsyncStream& operator=(const AsyncStream&&) = delete;
+
+    /**
+     * co_await stream.Push(std::move(item)) gives false if the stream is closed, the item is dropped then.
+     * the item should be a named object: gcc 12 copies class temporaries made inside a co_await expression bit
+     * by bit, which breaks e.g. a std::string in them.
+     */
+    PushAwaiter Push(T item);
+
+    // only one coroutine may wait in Next at a time
+    NextAwaiter Next()
+    {
+        return NextAwaiter(*this);
+    }
+
+    /**
+     * no more items are accepted, waiting producers go on with false and a waiting consumer goes on with what
+     * is left in the buffer. the producer closes the stream when it is done, the consumer closes it to stop
+     * producers early.
+     */
+    void Close();
+
+private:
+    // item seq, counted from 0 by Push, is within capacity once enough items before it are taken.
+    // _taken only grows, so a stale value read without the lock can only make an item wait, see PushAwaiter
+    bool Fits(uint64_t seq) const
+    {
+        return seq < _taken.load(std::memory_order_acquire) + _capacity;
+    }
+
+    std::optional<T> Take();
+
+    const size_t _capacity;
+    std::mutex _lock;
+    std::deque<T> _buffer;
+    uint64_t _pushed {0};
+    // written under _lock, read without it by PushAwaiter::await_ready
+    std::atomic<uint64_t> _taken {0};
+    std::deque<std::pair<uint64_t, std::coroutine_handle<>>> _waitingProducers;
+    std::coroutine_handle<> _consumer;
+    bool _closed {false};
+};
+
+template<typename T>
+typename AsyncStream<T>::PushAwaiter AsyncStream<T>::Push(T item)
+{
+    std::unique_lock<std::mutex> lock {_lock};
+    if (_closed) {
+        return PushAwaiter(*this, 0, false);
+    }
+    uint64_t seq = _pushed++;
+    _buffer.push_back(std::move(item));
+    auto consumer = std::exchange(_consumer, nullptr);
+    lock.unlock();
+    if (consumer) {
+        consumer.resume();
+    }
+    return PushAwaiter(*this, seq, true);
+}
+
+template<typename T>
+std::optional<T> AsyncStream<T>::Take()
+{
+    std::unique_lock<std::mutex> lock {_lock};
+    if (_buffer.empty()) {
+        return std::nullopt;
+    }
+    std::optional<T> item(std::move(_buffer.front()));
+    _buffer.pop_front();
+    _taken.fetch_add(1, std::memory_order_release);
+
+    // producers wait in the order of their items, the room goes to the one which has waited longest
+    if (_waitingProducers.empty() || !Fits(_waitingProducers.front().first)) {
+        return item;
+    }
+    auto producer = _waitingProducers.front().second;
+    _waitingProducers.pop_front();
+    lock.unlock();
+    producer.resume();
+    return item;
+}
+
+template<typename T>
+void AsyncStream<T>::Close()
+{
+    std::unique_lock<std::mutex> lock {_lock};
+    _closed = true;
+    auto consumer = std::exchange(_consumer, nullptr);
+    std::vector<std::coroutine_handle<>> producers;
+    for (const auto& [seq, handle] : _waitingProducers) {
+        producers.push_back(handle);
+    }
+    _waitingProducers.clear();
+    lock.unlock();
+
+    for (auto producer : producers) {
+        producer.resume();
+    }
+    if (consumer) {
+        consumer.resume();
+    }
+}
+
+#endif // ASYNC_STREAM_H
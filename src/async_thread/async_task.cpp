@@ -1,22 +1,54 @@
-#include <iostream>
 #include "async_task.h"
-#include "utils.h"
+#include "utils/utils.h"
 
-void AsyncTask::StartTask(std::promise<TaskContent> promiseObj, std::function<void(TaskContent&)> func)
+OneShotReceiver<AsyncTask::TaskContent> AsyncTask::Start(CancellationToken token)
 {
-    auto fut(promiseObj.get_future());
-    std::thread t(&AsyncTask::Task1, this, std::ref(promiseObj));
-    t.detach();
+    auto [sender, receiver] = MakeOneShot<TaskContent>();
+    auto task = [sender = std::move(sender), token = std::move(token)]() mutable {
+        // e.g. the loser of WhenAny, or the requester has gone away, nobody reads the result
+        if (!sender.IsCancelled() && !token.IsCancelled()) {
+            (void)sender.Send(Task1());
+        }
+    };
 
-    std::thread t1([&func, fut=std::move(fut)]() mutable {
-        auto result = fut.get();
-        func(result);
-    });
-    t1.detach();
+    // the future is not waited for, the channel is what delivers the result. a refused task is dropped with its
+    // sender, running it on the caller instead would undo the shedding of an overloaded executor
+    (void)_executor.AddTask(std::move(task));
+    return std::move(receiver);
 }
 
-void AsyncTask::Task1(std::promise<TaskContent>& promiseObj)
+Task<std::optional<AsyncTask::TaskContent>> AsyncTask::Fetch()
 {
-    PRINT_INFO("start task1...\n");
-    promiseObj.set_value({1, "id 1"});
-}
\ No newline at end of file
+    ScheduleOn hop(_executor);
+    if (!co_await hop) {
+        co_return std::nullopt;
+    }
+    co_return Task1();
+}
+
+Task<void> AsyncTask::Scan(AsyncStream<TaskContent>& stream, int num, CancellationToken token)
+{
+    ScheduleOn hop(_executor);
+    if (!co_await hop) {
+        stream.Close();
+        co_return;
+    }
+    for (int id = 1; id <= num; id++) {
+        if (token.IsCancelled()) {
+            // the consumer waits for an end, which it gets as the end of the stream
+            stream.Close();
+            co_return;
+        }
+        TaskContent content {id, "id " + std::to_string(id)};
+        if (!co_await stream.Push(std::move(content))) {
+            co_return;
+        }
+    }
+    stream.Close();
+}
+
+AsyncTask::TaskContent AsyncTask::Task1()
+{
+    PRINT_INFO("start task1...");
+    return {1, "id 1"};
+}
@@ -1,11 +1,22 @@
 #ifndef ASYNC_TASK_H
 #define ASYNC_TASK_H
 
-#include <future>
 #include <functional>
+#include <optional>
 #include <string>
-#include <memory>
+#include "async_scope.h"
+#include "async_stream.h"
+#include "cancellation.h"
+#include "completion_queue.h"
+#include "one_shot.h"
+#include "task.h"
+#include "thread_pool/thread_pool.h"
 
+/**
+ * runs its producer on an executor shared by all tasks and hands the result over by a one-shot channel, the
+ * callback runs as a continuation on whichever thread completes the handoff, so no thread is started for a
+ * task and no thread only waits for its result.
+ */
 class AsyncTask {
 public:
     struct TaskContent {
@@ -13,13 +24,74 @@ public:
         std::string name;
     };
 
-    AsyncTask() = default;
+    using Callback = std::function<void(TaskContent&)>;
+
+    /**
+     * the executor must outlive every task started by this AsyncTask, and its queue should hold the tasks
+     * started at once, e.g. a burst of requests. a task the executor refuses, e.g. shed by admission control,
+     * is not run, the caller sees it by the closed channel.
+     */
+    explicit AsyncTask(ThreadPool& executor) : _executor(executor)
+    {}
     ~AsyncTask() = default;
 
-    void StartTask(std::promise<TaskContent> promiseObj, std::function<void(TaskContent&)> func);
+    /**
+     * the result arrives by the returned receiver. it is never sent if the executor refuses the task, e.g. its
+     * queue is full, or the receiver or token is cancelled before the producer starts, the producer is skipped
+     * then: a Then callback is dropped, and a coroutine in co_await task.Start(token) goes on with nullopt.
+     */
+    OneShotReceiver<TaskContent> Start(CancellationToken token = {});
+
+    void StartTask(Callback func)
+    {
+        Start().Then(std::move(func));
+    }
+
+    // the callback is skipped as well if token is cancelled before the result arrives
+    void StartTask(Callback func, CancellationToken token)
+    {
+        Start(token).Then([token, func = std::move(func)](TaskContent& content) {
+            if (!token.IsCancelled()) {
+                func(content);
+            }
+        });
+    }
+
+    // the result is posted to queue with tag, for an owner thread which polls instead of taking callbacks
+    void StartTask(CompletionQueue<Tagged<TaskContent>>& queue, uint64_t tag, CancellationToken token = {})
+    {
+        PostTo(queue, tag, Start(std::move(token)));
+    }
+
+    // the callback is work of scope, cancelling scope cancels the task like a token
+    void StartTask(AsyncScope& scope, Callback func)
+    {
+        Start(scope.GetToken()).Then([ticket = scope.GetTicket(), func = std::move(func)](TaskContent& content) {
+            if (!ticket.IsCancelled()) {
+                func(content);
+            }
+        });
+    }
+
+    /**
+     * the same producer as a coroutine, for flows of several steps: auto content = co_await task.Fetch().
+     * it runs on the executor once awaited, and the awaiting coroutine goes on there, unless the executor is
+     * done before the await has returned, then it goes on on the awaiting thread, see TaskPromiseBase.
+     * nullopt if the executor refuses it, like Start.
+     */
+    Task<std::optional<TaskContent>> Fetch();
+
+    /**
+     * producer of a stream of num results with ids 1..num, like the pages of a scan. it runs on the executor,
+     * waits while the consumer is behind, and closes stream at its end, at once if the executor refuses it. it stops early once the consumer closes
+     * stream or token is cancelled, and stream must outlive it.
+     */
+    Task<void> Scan(AsyncStream<TaskContent>& stream, int num, CancellationToken token = {});
 
 private:
-    void Task1(std::promise<TaskContent>& promiseObj);
+    static TaskContent Task1();
+
+    ThreadPool& _executor;
 };
 
-#endif // ASYNC_TASK_H
\ No newline at end of file
+#endif // ASYNC_TASK_H
@@ -0,0 +1,68 @@
+#include "cancellation.h"
+
+uint64_t CancellationState::Register(UniqueTask func)
+{
+    {
+        std::lock_guard<std::mutex> lock {_lock};
+        if (!IsCancelled()) {
+            uint64_t id = _nextId++;
+            _callbacks.emplace(id, std::move(func));
+            return id;
+        }
+    }
+    func();
+    return 0;
+}
+
+void CancellationState::Unregister(uint64_t id)
+{
+    std::unique_lock<std::mutex> lock {_lock};
+    if (_callbacks.erase(id) != 0) {
+        return;
+    }
+    // a callback may unregister itself, only another thread waits for it to finish
+    if (_cancelThread != std::this_thread::get_id()) {
+        _callbackDone.wait(lock, [this, id]() { return _running != id; });
+    }
+}
+
+bool CancellationState::Cancel()
+{
+    std::unique_lock<std::mutex> lock {_lock};
+    if (_cancelled.exchange(1, std::memory_order_acq_rel) != 0) {
+        return false;
+    }
+    _cancelThread = std::this_thread::get_id();
+
+    // one by one, so a callback can unregister others which have not run yet
+    while (!_callbacks.empty()) {
+        auto first = _callbacks.begin();
+        _running = first->first;
+        auto func = std::move(first->second);
+        _callbacks.erase(first);
+        lock.unlock();
+        func();
+        func = UniqueTask();
+        lock.lock();
+        _running = 0;
+        _callbackDone.notify_all();
+    }
+    return true;
+}
+
+CancellationRegistration CancellationToken::Register(UniqueTask func) const
+{
+    if (_state == nullptr) {
+        return CancellationRegistration();
+    }
+    return CancellationRegistration(_state, _state->Register(std::move(func)));
+}
+
+CancellationSource::CancellationSource(const std::vector<CancellationToken>& parents) :
+    _state(std::make_shared<CancellationState>())
+{
+    for (const auto& parent : parents) {
+        // the parent keeps the state alive only as long as the link, which the source owns
+        _links.push_back(parent.Register([state = _state]() { (void)state->Cancel(); }));
+    }
+}
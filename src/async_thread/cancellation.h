@@ -0,0 +1,164 @@
+#ifndef CANCELLATION_H
+#define CANCELLATION_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "thread_pool/unique_task.h"
+
+class CancellationToken;
+
+// state shared by a source and its tokens, see CancellationSource
+class CancellationState {
+public:
+    bool IsCancelled() const
+    {
+        return _cancelled.load(std::memory_order_acquire) != 0;
+    }
+
+    // 0 if func has run at once because the state is cancelled already
+    uint64_t Register(UniqueTask func);
+    void Unregister(uint64_t id);
+    // false if it has been cancelled before
+    bool Cancel();
+
+private:
+    std::atomic<uint32_t> _cancelled {0};
+    std::mutex _lock;
+    std::condition_variable _callbackDone;
+    std::map<uint64_t, UniqueTask> _callbacks;
+    uint64_t _nextId {1};
+    // the callback being run by Cancel, and the thread running it
+    uint64_t _running {0};
+    std::thread::id _cancelThread;
+};
+
+/**
+ * a callback registered on a token, it is unregistered when this is destroyed. if the callback is running on
+ * another thread at that time, the destructor waits for it, so the callback may use whatever the registration
+ * lives with.
+ */
+class CancellationRegistration {
+public:
+    CancellationRegistration() = default;
+    CancellationRegistration(std::shared_ptr<CancellationState> state, uint64_t id) :
+        _state(std::move(state)), _id(id)
+    {}
+
+    ~CancellationRegistration()
+    {
+        Reset();
+    }
+
+    CancellationRegistration(CancellationRegistration&& other) noexcept :
+        _state(std::move(other._state)), _id(std::exchange(other._id, 0))
+    {}
+
+    CancellationRegistration& operator=(CancellationRegistration&& other) noexcept
+    {
+        if (this != &other) {
+            Reset();
+            _state = std::move(other._state);
+            _id = std::exchange(other._id, 0);
+        }
+        return *this;
+    }
+
+    CancellationRegistration(const CancellationRegistration&) = delete;
+    CancellationRegistration& operator=(const CancellationRegistration&) = delete;
+
+private:
+    void Reset()
+    {
+        if ((_state != nullptr) && (_id != 0)) {
+            _state->Unregister(_id);
+        }
+        _state.reset();
+        _id = 0;
+    }
+
+    std::shared_ptr<CancellationState> _state;
+    uint64_t _id {0};
+};
+
+/**
+ * what a producer gets to learn that its result is not needed any more. it is cheap to copy and to check, so
+ * work can poll IsCancelled between steps, and in-flight I/O registers a callback which aborts it.
+ * a default token is never cancelled.
+ */
+class CancellationToken {
+public:
+    CancellationToken() = default;
+    explicit CancellationToken(std::shared_ptr<CancellationState> state) : _state(std::move(state))
+    {}
+
+    bool IsCancelled() const
+    {
+        return (_state != nullptr) && _state->IsCancelled();
+    }
+
+    // false for a default token, which can never be cancelled
+    bool CanBeCancelled() const
+    {
+        return _state != nullptr;
+    }
+
+    /**
+     * func() runs once on cancellation, on the thread calling Cancel, or inside this call if the token is
+     * cancelled already. it should be short, e.g. close a socket or cancel a timer.
+     */
+    [[nodiscard]] CancellationRegistration Register(UniqueTask func) const;
+
+private:
+    std::shared_ptr<CancellationState> _state;
+};
+
+/**
+ * owner of a cancellation, it hands out tokens and cancels them all at once. a linked source is cancelled
+ * with any of its parents as well, so every step of a chain can have a source of its own, e.g. with a timeout,
+ * and still stop when the whole chain is cancelled.
+ */
+class CancellationSource {
+public:
+    CancellationSource() : _state(std::make_shared<CancellationState>())
+    {}
+
+    explicit CancellationSource(const CancellationToken& parent) : CancellationSource(std::vector {parent})
+    {}
+
+    explicit CancellationSource(const std::vector<CancellationToken>& parents);
+
+    CancellationSource(CancellationSource&&) noexcept = default;
+    CancellationSource& operator=(CancellationSource&&) noexcept = default;
+    CancellationSource(const CancellationSource&) = delete;
+    CancellationSource& operator=(const CancellationSource&) = delete;
+
+    CancellationToken GetToken() const
+    {
+        return CancellationToken(_state);
+    }
+
+    // runs the callbacks registered on the tokens on the calling thread, false if cancelled before
+    bool Cancel()
+    {
+        return _state->Cancel();
+    }
+
+    bool IsCancelled() const
+    {
+        return _state->IsCancelled();
+    }
+
+private:
+    std::shared_ptr<CancellationState> _state;
+    // the links to the parents go away with the source
+    std::vector<CancellationRegistration> _links;
+};
+
+#endif // CANCELLATION_H
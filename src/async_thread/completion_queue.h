@@ -0,0 +1,138 @@
+#ifndef COMPLETION_QUEUE_H
+#define COMPLETION_QUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <utility>
+#include <vector>
+#include "one_shot.h"
+#include "thread_pool/thread_pool_policy.h"
+
+/**
+ * completions posted by any thread and drained in batches by the one thread which owns the queue, e.g. a
+ * network loop. no user code runs on the posting threads, and the owner touches the completions on its own
+ * thread only, so they do not bounce between the caches of threads the way callbacks do.
+ * the queue is the MPSC queue of Dmitry Vyukov: Post is one exchange and one store and never waits
+ * for another producer or for the owner. the owner sleeps in Wait only when the queue is empty, posting wakes
+ * it without a lock as long as it is not sleeping.
+ */
+template<typename T>
+class CompletionQueue {
+public:
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+    CompletionQueue() : _head(&_stub), _tail(&_stub)
+    {}
+
+    ~CompletionQueue()
+    {
+        std::optional<T> value;
+        while (TryPop(value)) {
+        }
+        if (_tail != &_stub) {
+            delete _tail;
+        }
+    }
+
+    CompletionQueue(const CompletionQueue&) = delete;
+    CompletionQueue& operator=(const CompletionQueue&) = delete;
+    CompletionQueue(const CompletionQueue&&) = delete;
+    CompletionQueue& operator=(const CompletionQueue&&) = delete;
+
+    // any thread
+    void Post(T value)
+    {
+        auto node = new Node();
+        node->value.emplace(std::move(value));
+        Node* prev = _head.exchange(node, std::memory_order_acq_rel);
+        // between the exchange and this store the owner sees the queue end at prev, it is woken up below anyway
+        prev->next.store(node, std::memory_order_release);
+        _wait.NotifyOne();
+    }
+
+    // owner thread only: move up to max completions into out without waiting, the number moved is returned
+    size_t Poll(std::vector<T>& out, size_t max = std::numeric_limits<size_t>::max())
+    {
+        size_t num = 0;
+        std::optional<T> value;
+        while ((num < max) && TryPop(value)) {
+            out.push_back(std::move(*value));
+            num++;
+        }
+        return num;
+    }
+
+    /**
+     * owner thread only: move completions into out until there are n of them or timeout has passed, the
+     * number moved is returned. completions are taken as soon as they are there, so a batch cut short by the
+     * timeout still has all which arrived in time.
+     */
+    template<typename Rep, typename Period>
+    size_t Wait(std::vector<T>& out, size_t n, std::chrono::duration<Rep, Period> timeout)
+    {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        size_t num = Poll(out, n);
+        while (num < n) {
+            auto left = deadline - std::chrono::steady_clock::now();
+            if ((left <= left.zero()) || !_wait.WaitFor([this]() { return !Empty(); }, left)) {
+                break;
+            }
+            num += Poll(out, n - num);
+        }
+        return num;
+    }
+
+private:
+    struct Node {
+        std::atomic<Node*> next {nullptr};
+        std::optional<T> value;
+    };
+
+    // owner thread only
+    bool Empty() const
+    {
+        return _tail->next.load(std::memory_order_acquire) == nullptr;
+    }
+
+    // owner thread only, the node of the value taken becomes the new stub at the tail
+    bool TryPop(std::optional<T>& value)
+    {
+        Node* tail = _tail;
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if (next == nullptr) {
+            return false;
+        }
+        _tail = next;
+        value.emplace(std::move(*next->value));
+        next->value.reset();
+        if (tail != &_stub) {
+            delete tail;
+        }
+        return true;
+    }
+
+    alignas(CACHE_LINE_SIZE) std::atomic<Node*> _head;
+    alignas(CACHE_LINE_SIZE) Node* _tail;
+    Node _stub;
+    BlockingWait _wait;
+};
+
+// a completion with the tag the owner gave its operation
+template<typename T>
+struct Tagged {
+    uint64_t tag;
+    T value;
+};
+
+// the value of receiver is posted to queue once it arrives, the sending thread only posts it
+template<typename T>
+void PostTo(CompletionQueue<Tagged<T>>& queue, uint64_t tag, OneShotReceiver<T> receiver)
+{
+    receiver.Then([&queue, tag](T& value) { queue.Post(Tagged<T> {tag, std::move(value)}); });
+}
+
+#endif // COMPLETION_QUEUE_H
@@ -0,0 +1,390 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "async_stream.h"
+#include "completion_queue.h"
+#include "one_shot.h"
+#include "task.h"
+#include "thread_pool/thread_pool.h"
+#include "utils/metrics.h"
+
+/**
+ * producer-to-consumer handoff latency and throughput of the async models of this module:
+ * handoff_bench [ops per thread] [max threads]
+ * - handoff: a producer thread stamps a value and hands it over, the latency ends where the consumer thread sees
+ *   it. the consumer is a thread blocked in future::get, a thread woken by a one-shot callback, a coroutine
+ *   awaiting a one-shot receiver or reading an AsyncStream and hopping back onto its own thread, or a thread
+ *   waiting on a CompletionQueue.
+ * - executor: a submitting thread starts a task on a ThreadPool and waits for it, the latency is from submit
+ *   to the result, by future::get as in SyncWait, by the callback of a one-shot channel as in StartTask, or by
+ *   a coroutine which hops onto the pool by ScheduleOn as in Fetch and back onto its own thread.
+ * every row is run with 1, 2, 4 ... threads (pairs of producer and consumer for handoff) at once.
+ */
+namespace {
+using Clock = std::chrono::steady_clock;
+using Histogram = Metrics::Histogram;
+
+constexpr uint32_t POOL_SIZE = 4;
+constexpr uint32_t QUEUE_SIZE = 10;
+
+uint64_t NsSince(Clock::time_point start)
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+}
+
+void WaitUntil(const std::atomic<uint64_t>& value, uint64_t expected)
+{
+    while (value.load(std::memory_order_acquire) < expected) {
+        std::this_thread::yield();
+    }
+}
+
+// runs body(i) for i in [0, num) on num threads started together, gives the seconds until all are done
+template<typename F>
+double RunThreads(uint32_t num, F&& body)
+{
+    std::atomic<uint32_t> ready {0};
+    std::atomic<uint32_t> go {0};
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < num; i++) {
+        threads.emplace_back([&, i]() {
+            ready.fetch_add(1);
+            while (go.load(std::memory_order_acquire) == 0) {
+                std::this_thread::yield();
+            }
+            body(i);
+        });
+    }
+    while (ready.load() != num) {
+        std::this_thread::yield();
+    }
+    auto start = Clock::now();
+    go.store(1, std::memory_order_release);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void PrintHeader(const char* section)
+{
+    printf("\n%s\n", section);
+    printf("%-18s %7s %12s %9s %9s %9s %9s %11s\n", "path", "threads", "ops/s", "p50(ns)", "p90(ns)", "p99(ns)",
+           "p999(ns)", "max(ns)");
+}
+
+void Report(const char* path, uint32_t threads, uint64_t ops, double seconds, const Histogram& latency)
+{
+    auto snapshot = latency.Get();
+    printf("%-18s %7u %12.0f %9lu %9lu %9lu %9lu %11lu\n", path, threads, static_cast<double>(ops) / seconds,
+           snapshot.Percentile(0.5), snapshot.Percentile(0.9), snapshot.Percentile(0.99),
+           snapshot.Percentile(0.999), snapshot.max);
+}
+
+// handoff: every value goes from a producer thread to a consumer thread. a one-shot channel or promise is made
+// by the consumer for every value, inside the timed run, and handed over by a mailbox, so the producer waits
+// until the consumer has taken the previous value and only one handoff is in flight
+
+// a coroutine goes on on the thread which completed its handoff, so every coroutine gets a single-worker pool
+// and hops back onto it, like a coroutine which must keep to its own thread. they are started once for all rows
+using Executors = std::vector<std::unique_ptr<ThreadPool>>;
+
+Executors StartExecutors(uint32_t num)
+{
+    Executors executors;
+    for (uint32_t i = 0; i < num; i++) {
+        executors.push_back(std::make_unique<ThreadPool>(1, QUEUE_SIZE));
+        executors.back()->Init();
+    }
+    return executors;
+}
+
+void StopExecutors(Executors& executors)
+{
+    for (auto& executor : executors) {
+        executor->Destroy();
+    }
+}
+
+// blocks until the coroutine behind done has finished
+void WaitDone(OneShotReceiver<int> done)
+{
+    std::promise<void> finished;
+    done.Then([&finished](int&) { finished.set_value(); });
+    finished.get_future().wait();
+}
+
+template<typename Sender>
+struct Mailbox {
+    Sender sender;                       // written by the consumer before it bumps published
+    std::atomic<uint64_t> published {0}; // channels handed over so far
+};
+
+template<typename Sender>
+void Publish(Mailbox<Sender>& box, Sender sender, uint64_t op)
+{
+    box.sender = std::move(sender);
+    box.published.store(op + 1, std::memory_order_release);
+}
+
+// send(sender, stamp) delivers one value by the sender the consumer has published
+template<typename Sender, typename F>
+void Produce(Mailbox<Sender>& box, uint64_t ops, F&& send)
+{
+    for (uint64_t op = 0; op < ops; op++) {
+        WaitUntil(box.published, op + 1);
+        send(std::move(box.sender), Clock::now());
+    }
+}
+
+double FutureHandoff(Executors&, uint32_t pairs, uint64_t ops, Histogram& latency)
+{
+    using Promise = std::promise<Clock::time_point>;
+    std::vector<Mailbox<Promise>> boxes(pairs);
+    return RunThreads(pairs * 2, [&](uint32_t i) {
+        auto& box = boxes[i / 2];
+        if (i % 2 == 0) {
+            Produce(box, ops, [](Promise promise, Clock::time_point stamp) { promise.set_value(stamp); });
+            return;
+        }
+        for (uint64_t op = 0; op < ops; op++) {
+            Promise promise;
+            auto future = promise.get_future();
+            Publish(box, std::move(promise), op);
+            latency.Record(NsSince(future.get()));
+        }
+    });
+}
+
+using StampSender = OneShotSender<Clock::time_point>;
+
+void SendStamp(StampSender sender, Clock::time_point stamp)
+{
+    (void)sender.Send(stamp);
+}
+
+double CallbackHandoff(Executors&, uint32_t pairs, uint64_t ops, Histogram& latency)
+{
+    std::vector<Mailbox<StampSender>> boxes(pairs);
+    return RunThreads(pairs * 2, [&](uint32_t i) {
+        auto& box = boxes[i / 2];
+        if (i % 2 == 0) {
+            Produce(box, ops, SendStamp);
+            return;
+        }
+        // the callback runs inside Send on the producer thread, it only hands the value over to this thread
+        Clock::time_point stamp;
+        std::atomic<uint64_t> arrived {0};
+        for (uint64_t op = 0; op < ops; op++) {
+            auto [sender, receiver] = MakeOneShot<Clock::time_point>();
+            receiver.Then([&stamp, &arrived, op](Clock::time_point& value) {
+                stamp = value;
+                arrived.store(op + 1, std::memory_order_release);
+            });
+            Publish(box, std::move(sender), op);
+            WaitUntil(arrived, op + 1);
+            latency.Record(NsSince(stamp));
+        }
+    });
+}
+
+Task<int> AwaitOn(ThreadPool& executor, Mailbox<StampSender>& box, uint64_t ops, Histogram& latency)
+{
+    co_await ScheduleOn(executor);
+    for (uint64_t op = 0; op < ops; op++) {
+        auto channel = MakeOneShot<Clock::time_point>();
+        Publish(box, std::move(channel.first), op);
+        auto stamp = co_await std::move(channel.second);
+        co_await ScheduleOn(executor);
+        latency.Record(NsSince(*stamp));
+    }
+    co_return 0;
+}
+
+double CoroutineHandoff(Executors& executors, uint32_t pairs, uint64_t ops, Histogram& latency)
+{
+    std::vector<Mailbox<StampSender>> boxes(pairs);
+    return RunThreads(pairs * 2, [&](uint32_t i) {
+        auto& box = boxes[i / 2];
+        if (i % 2 == 0) {
+            Produce(box, ops, SendStamp);
+            return;
+        }
+        WaitDone(Launch(AwaitOn(*executors[i], box, ops, latency)));
+    });
+}
+
+Task<int> ReadStream(ThreadPool& executor, AsyncStream<Clock::time_point>& stream, Histogram& latency)
+{
+    co_await ScheduleOn(executor);
+    while (auto stamp = co_await stream.Next()) {
+        co_await ScheduleOn(executor);
+        latency.Record(NsSince(*stamp));
+    }
+    co_return 0;
+}
+
+Task<int> WriteStream(ThreadPool& executor, AsyncStream<Clock::time_point>& stream, uint64_t ops)
+{
+    co_await ScheduleOn(executor);
+    for (uint64_t op = 0; op < ops; op++) {
+        auto stamp = Clock::now();
+        (void)co_await stream.Push(std::move(stamp));
+        co_await ScheduleOn(executor);
+    }
+    stream.Close();
+    co_return 0;
+}
+
+// the stream is the long-lived channel of a pair, its capacity of 1 keeps one value in flight
+double StreamHandoff(Executors& executors, uint32_t pairs, uint64_t ops, Histogram& latency)
+{
+    std::vector<std::unique_ptr<AsyncStream<Clock::time_point>>> streams;
+    for (uint32_t i = 0; i < pairs; i++) {
+        streams.push_back(std::make_unique<AsyncStream<Clock::time_point>>(1));
+    }
+    return RunThreads(pairs * 2, [&](uint32_t i) {
+        auto& stream = *streams[i / 2];
+        if (i % 2 == 0) {
+            WaitDone(Launch(WriteStream(*executors[i], stream, ops)));
+        } else {
+            WaitDone(Launch(ReadStream(*executors[i], stream, latency)));
+        }
+    });
+}
+
+// the completion queue is the long-lived channel of a pair as well
+double QueueHandoff(Executors&, uint32_t pairs, uint64_t ops, Histogram& latency)
+{
+    struct Pair {
+        CompletionQueue<Clock::time_point> queue;
+        std::atomic<uint64_t> consumed {0};
+    };
+    std::vector<Pair> all(pairs);
+    return RunThreads(pairs * 2, [&](uint32_t i) {
+        auto& pair = all[i / 2];
+        if (i % 2 == 0) {
+            for (uint64_t op = 0; op < ops; op++) {
+                WaitUntil(pair.consumed, op);
+                pair.queue.Post(Clock::now());
+            }
+            return;
+        }
+        std::vector<Clock::time_point> batch;
+        for (uint64_t op = 0; op < ops;) {
+            batch.clear();
+            (void)pair.queue.Wait(batch, 1, std::chrono::seconds(1));
+            for (auto stamp : batch) {
+                latency.Record(NsSince(stamp));
+                pair.consumed.store(++op, std::memory_order_release);
+            }
+        }
+    });
+}
+
+// executor: every submitting thread has one task in flight, so the queue of the pool never refuses it
+
+double FutureExecutor(ThreadPool& pool, Executors&, uint32_t threads, uint64_t ops, Histogram& latency)
+{
+    return RunThreads(threads, [&](uint32_t) {
+        for (uint64_t op = 0; op < ops; op++) {
+            auto start = Clock::now();
+            auto result = pool.AddTask([]() { return 0; });
+            if (result.valid()) {
+                (void)result.get();
+            }
+            latency.Record(NsSince(start));
+        }
+    });
+}
+
+double CallbackExecutor(ThreadPool& pool, Executors&, uint32_t threads, uint64_t ops, Histogram& latency)
+{
+    return RunThreads(threads, [&](uint32_t) {
+        std::atomic<uint64_t> done {0};
+        for (uint64_t op = 0; op < ops; op++) {
+            auto [sender, receiver] = MakeOneShot<Clock::time_point>();
+            receiver.Then([&](Clock::time_point& start) {
+                latency.Record(NsSince(start));
+                done.fetch_add(1, std::memory_order_release);
+            });
+            auto task = [sender = std::move(sender), start = Clock::now()]() mutable { (void)sender.Send(start); };
+            if (!pool.AddTask(task).valid()) {
+                task();
+            }
+            WaitUntil(done, op + 1);
+        }
+    });
+}
+
+// every round trip starts from the own thread of the coroutine, or a worker of pool would only re-queue to pool
+Task<int> HopOnExecutor(ThreadPool& pool, ThreadPool& home, uint64_t ops, Histogram& latency)
+{
+    co_await ScheduleOn(home);
+    for (uint64_t op = 0; op < ops; op++) {
+        auto start = Clock::now();
+        co_await ScheduleOn(pool);
+        co_await ScheduleOn(home);
+        latency.Record(NsSince(start));
+    }
+    co_return 0;
+}
+
+double CoroutineExecutor(ThreadPool& pool, Executors& executors, uint32_t threads, uint64_t ops, Histogram& latency)
+{
+    return RunThreads(threads, [&](uint32_t i) { WaitDone(Launch(HopOnExecutor(pool, *executors[i], ops, latency))); });
+}
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    uint64_t ops = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 20000;
+    uint32_t maxThreads = (argc > 2) ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 8;
+    if ((ops == 0) || (maxThreads == 0)) {
+        fprintf(stderr, "usage: %s [ops per thread] [max threads]\n", argv[0]);
+        return 1;
+    }
+
+    using HandoffPath = double (*)(Executors&, uint32_t, uint64_t, Histogram&);
+    const std::pair<const char*, HandoffPath> handoffPaths[] = {
+        {"future", FutureHandoff},
+        {"one_shot_callback", CallbackHandoff},
+        {"one_shot_co_await", CoroutineHandoff},
+        {"async_stream", StreamHandoff},
+        {"completion_queue", QueueHandoff},
+    };
+    auto executors = StartExecutors(maxThreads * 2);
+    PrintHeader("handoff (threads = producer/consumer pairs)");
+    for (const auto& [name, path] : handoffPaths) {
+        for (uint32_t threads = 1; threads <= maxThreads; threads *= 2) {
+            Histogram latency;
+            double seconds = path(executors, threads, ops, latency);
+            Report(name, threads, ops * threads, seconds, latency);
+        }
+    }
+
+    ThreadPool pool(POOL_SIZE, QUEUE_SIZE);
+    pool.Init();
+    using ExecutorPath = double (*)(ThreadPool&, Executors&, uint32_t, uint64_t, Histogram&);
+    const std::pair<const char*, ExecutorPath> executorPaths[] = {
+        {"future", FutureExecutor},
+        {"one_shot_callback", CallbackExecutor},
+        {"schedule_on", CoroutineExecutor},
+    };
+    PrintHeader("executor round trip (threads = submitting threads)");
+    for (const auto& [name, path] : executorPaths) {
+        for (uint32_t threads = 1; threads <= maxThreads; threads *= 2) {
+            Histogram latency;
+            double seconds = path(pool, executors, threads, ops, latency);
+            Report(name, threads, ops * threads, seconds, latency);
+        }
+    }
+    pool.Destroy();
+    StopExecutors(executors);
+    return 0;
+}
@@ -2,26 +2,28 @@
 #include <chrono>
 #include <future>
 #include <iostream>
-#include "utils.h"
+#include <vector>
 #include "async_task.h"
+#include "timer_service.h"
+#include "utils/utils.h"
 
-void thread1(std::promise<int>* promiseObj)
+// the producer of SyncWait, its latency is a timer, so no thread sleeps through it
+void Produce1(TimerService& timer, std::promise<int> promiseObj)
 {
-    PRINT_INFO("start thread1...\n");
-    std::this_thread::sleep_for(std::chrono::seconds(3));
-    promiseObj->set_value(3);
+    PRINT_INFO("start produce1...\n");
+    timer.ScheduleAfter(std::chrono::seconds(3),
+                        [promiseObj = std::move(promiseObj)]() mutable { promiseObj.set_value(3); });
 }
 
-void SyncWait()
+void SyncWait(TimerService& timer)
 {
     std::promise<int> promiseObj;
     std::future<int> futureObj = promiseObj.get_future();
-    std::thread t(thread1, &promiseObj);
-    t.detach();
-    PRINT_INFO("continue in SyncWait after thread1...\n");
+    Produce1(timer, std::move(promiseObj));
+    PRINT_INFO("continue in SyncWait after produce1...\n");
 
     auto result = futureObj.get();
-    PRINT_INFO("get result form thread1 in SyncWait: %d\n", result);
+    PRINT_INFO("get result form produce1 in SyncWait: %d\n", result);
 }
 
 void AsyncWait(AsyncTask::TaskContent& result)
@@ -29,17 +31,74 @@ void AsyncWait(AsyncTask::TaskContent& result)
     std::cout << "result id is: " << result.id << ", name is: " << result.name << std::endl;
 }
 
+// two steps read like sync code, and no thread waits between them
+Task<void> CoroutineWait(AsyncTask& taskObj)
+{
+    auto first = co_await taskObj.Fetch();
+    auto second = co_await taskObj.Start();
+    if (first && second) {
+        PRINT_INFO("sum of ids in CoroutineWait: %d\n", first->id + second->id);
+    }
+}
+
+// waiting and deadlines are timers too, a sleeping coroutine holds no thread
+Task<void> TimedWait(AsyncTask& taskObj, TimerService& timer)
+{
+    co_await SleepFor(timer, std::chrono::milliseconds(100));
+    auto result = co_await WithTimeout(timer, taskObj.Start(), TimerService::Clock::now() + std::chrono::seconds(1));
+    if (result && (result->status == TimeoutStatus::OK)) {
+        PRINT_INFO("result id in TimedWait: %d\n", result->value->id);
+    } else {
+        PRINT_INFO("timeout in TimedWait\n");
+    }
+}
+
+// results arrive one by one while they are produced, the producer is held back while this is behind
+Task<void> StreamWait(AsyncStream<AsyncTask::TaskContent>& stream)
+{
+    int sum = 0;
+    while (auto content = co_await stream.Next()) {
+        sum += content->id;
+    }
+    PRINT_INFO("sum of streamed ids in StreamWait: %d\n", sum);
+}
+
 int main()
 {
+    TimerService timer;
     // sync test
-    SyncWait();
-    
+    SyncWait(timer);
+
     // async test
-    auto taskObj = std::make_unique<AsyncTask>();
-    auto promiseObj = std::promise<AsyncTask::TaskContent>();
-    taskObj->StartTask(std::move(promiseObj), AsyncWait);
+    ThreadPool executor(2, 10);
+    executor.Init();
+    auto taskObj = std::make_unique<AsyncTask>(executor);
+    AsyncStream<AsyncTask::TaskContent> stream(2);
+    {
+        // everything started in scope is done when it goes out of scope
+        AsyncScope scope;
+        taskObj->StartTask(scope, AsyncWait);
+
+        // coroutine test
+        scope.Spawn(CoroutineWait(*taskObj));
+        scope.Spawn(TimedWait(*taskObj, timer));
+
+        // stream test
+        scope.Spawn(taskObj->Scan(stream, 10));
+        scope.Spawn(StreamWait(stream));
+    }
 
-    std::this_thread::sleep_for(std::chrono::seconds(10));
+    // completion queue test: results are taken in batches on this thread instead of by callbacks
+    CompletionQueue<Tagged<AsyncTask::TaskContent>> completions;
+    for (uint64_t tag = 0; tag < 2; tag++) {
+        taskObj->StartTask(completions, tag);
+    }
+    std::vector<Tagged<AsyncTask::TaskContent>> batch;
+    while (batch.size() < 2) {
+        completions.Wait(batch, 2 - batch.size(), std::chrono::seconds(1));
+    }
+    PRINT_INFO("got %zu completions in main\n", batch.size());
+    executor.Destroy();
     PRINT_INFO("end main\n");
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,473 @@
+#ifndef ONE_SHOT_H
+#define ONE_SHOT_H
+
+#include <atomic>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "thread_pool/unique_task.h"
+
+/**
+ * state shared by the two ends of a one-shot channel. the value, the callback and the reference count are
+ * all inside, and every step of the handoff is one bit of _flags, so Send and Then meet in a single atomic
+ * word: whichever of them sets its bit second runs the callback right away on its own thread.
+ * released states go back to the free list of the thread which allocated them, like the remote frees of SlabHeap,
+ * and are reused by its next channel. so a handoff in steady state allocates nothing, even when the other end
+ * releases last on another thread, as long as the callback fits in the inline buffer of UniqueTask.
+ */
+template<typename T>
+class OneShotState {
+public:
+    static constexpr uint32_t CLAIMED = 1;    // a sender has started to write the value
+    static constexpr uint32_t VALUE = 2;      // the value is written
+    static constexpr uint32_t CALLBACK = 4;   // the callback is set
+    static constexpr uint32_t CANCELLED = 8;  // nobody needs the value any more
+    static constexpr uint32_t CLOSED = 16;    // all senders are gone
+    static constexpr uint32_t ON_CLOSED = 32; // the callback runs on CLOSED without a value as well
+
+    // the new state is referenced by its sender and its receiver
+    static OneShotState* New();
+
+    void AddRef()
+    {
+        _refs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void Release();
+
+    void AddSender()
+    {
+        _senders.fetch_add(1, std::memory_order_relaxed);
+        AddRef();
+    }
+
+    void ReleaseSender();
+
+    template<typename U>
+    bool Send(U&& value);
+
+    template<typename F>
+    void Then(F&& func)
+    {
+        SetCallback(UniqueTask([this, func = std::forward<F>(func)]() mutable { func(*Value()); }), 0);
+    }
+
+    template<typename F>
+    void ThenOrClosed(F&& func)
+    {
+        SetCallback(UniqueTask([this, func = std::forward<F>(func)]() mutable {
+                        func(((_flags.load(std::memory_order_acquire) & VALUE) != 0) ? Value() : nullptr);
+                    }),
+                    ON_CLOSED);
+    }
+
+    bool Ready() const
+    {
+        return (_flags.load(std::memory_order_acquire) & VALUE) != 0;
+    }
+
+    void Cancel()
+    {
+        _flags.fetch_or(CANCELLED, std::memory_order_relaxed);
+    }
+
+    bool IsCancelled() const
+    {
+        return (_flags.load(std::memory_order_relaxed) & CANCELLED) != 0;
+    }
+
+private:
+    static constexpr uint32_t MAX_CACHED = 64;
+
+    /**
+     * free states of one thread. the owner pushes and pops local without any atomic, other threads push to remote,
+     * and the owner takes remote back in one exchange when local runs out. it lives as long as the owner thread
+     * or any state allocated by it, whichever is longer.
+     */
+    struct FreeList {
+        OneShotState* local {nullptr};
+        uint32_t size {0};
+        std::atomic<OneShotState*> remote {nullptr};
+        std::atomic<uint32_t> refs {1};  // the owner thread and every state it has allocated
+
+        void Unref()
+        {
+            if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                delete this;
+            }
+        }
+    };
+
+    // frees the cached states when its thread exits, a state released after that is freed by the releasing thread
+    struct LocalFreeListOwner {
+        FreeList* freeList {new FreeList()};
+
+        ~LocalFreeListOwner()
+        {
+            FreeAll(freeList->remote.exchange(Closed(), std::memory_order_acquire));
+            FreeAll(std::exchange(freeList->local, nullptr));
+            freeList->Unref();
+        }
+    };
+
+    static FreeList* LocalFreeList()
+    {
+        static thread_local LocalFreeListOwner owner;
+        return owner.freeList;
+    }
+
+    // remote of a free list whose thread has exited, never dereferenced
+    static OneShotState* Closed()
+    {
+        return reinterpret_cast<OneShotState*>(alignof(OneShotState));
+    }
+
+    static void Free(OneShotState* state)
+    {
+        FreeList* home = state->_home;
+        delete state;
+        home->Unref();
+    }
+
+    static void FreeAll(OneShotState* head)
+    {
+        while (head != nullptr) {
+            Free(std::exchange(head, head->_nextFree));
+        }
+    }
+
+    T* Value()
+    {
+        return std::launder(reinterpret_cast<T*>(_value));
+    }
+
+    void SetCallback(UniqueTask callback, uint32_t onClosed);
+
+    std::atomic<uint32_t> _flags {0};
+    std::atomic<uint32_t> _refs {0};
+    std::atomic<uint32_t> _senders {0};
+    alignas(T) unsigned char _value[sizeof(T)];
+    UniqueTask _callback;
+    OneShotState* _nextFree {nullptr};
+    FreeList* _home {nullptr};
+};
+
+template<typename T>
+OneShotState<T>* OneShotState<T>::New()
+{
+    FreeList* freeList = LocalFreeList();
+    if (freeList->local == nullptr) {
+        // states released by other threads come back as a whole batch
+        freeList->local = freeList->remote.exchange(nullptr, std::memory_order_acquire);
+        for (OneShotState* state = freeList->local; state != nullptr; state = state->_nextFree) {
+            freeList->size++;
+        }
+    }
+
+    OneShotState* state = freeList->local;
+    if (state != nullptr) {
+        freeList->local = state->_nextFree;
+        freeList->size--;
+    } else {
+        state = new OneShotState();
+        state->_home = freeList;
+        freeList->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+    state->_flags.store(0, std::memory_order_relaxed);
+    state->_refs.store(2, std::memory_order_relaxed);
+    state->_senders.store(1, std::memory_order_relaxed);
+    return state;
+}
+
+template<typename T>
+void OneShotState<T>::Release()
+{
+    if (_refs.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+        return;
+    }
+
+    // a callback which never ran is dropped here, with what it captured
+    _callback = UniqueTask();
+    if ((_flags.load(std::memory_order_relaxed) & VALUE) != 0) {
+        Value()->~T();
+    }
+
+    FreeList* home = _home;
+    if (home == LocalFreeList()) {
+        if (home->size >= MAX_CACHED) {
+            Free(this);
+            return;
+        }
+        _nextFree = home->local;
+        home->local = this;
+        home->size++;
+        return;
+    }
+
+    OneShotState* head = home->remote.load(std::memory_order_relaxed);
+    do {
+        if (head == Closed()) {
+            Free(this);
+            return;
+        }
+        _nextFree = head;
+    } while (!home->remote.compare_exchange_weak(head, this, std::memory_order_release, std::memory_order_relaxed));
+}
+
+template<typename T>
+template<typename U>
+bool OneShotState<T>::Send(U&& value)
+{
+    if ((_flags.fetch_or(CLAIMED, std::memory_order_relaxed) & CLAIMED) != 0) {
+        return false;
+    }
+
+    new (_value) T(std::forward<U>(value));
+    if ((_flags.fetch_or(VALUE, std::memory_order_acq_rel) & CALLBACK) != 0) {
+        _callback();
+        _callback = UniqueTask();
+    }
+    return true;
+}
+
+template<typename T>
+void OneShotState<T>::ReleaseSender()
+{
+    // a callback which can not get a value any more is run for the closing or dropped now, what it captured may
+    // refer back to this state
+    if (_senders.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        uint32_t flags = _flags.fetch_or(CLOSED, std::memory_order_acq_rel);
+        if ((flags & (CALLBACK | VALUE)) == CALLBACK) {
+            if ((flags & ON_CLOSED) != 0) {
+                _callback();
+            }
+            _callback = UniqueTask();
+        }
+    }
+    Release();
+}
+
+template<typename T>
+void OneShotState<T>::SetCallback(UniqueTask callback, uint32_t onClosed)
+{
+    _callback = std::move(callback);
+    uint32_t flags = _flags.fetch_or(CALLBACK | onClosed, std::memory_order_acq_rel);
+    if ((flags & (VALUE | CLOSED)) != 0) {
+        // a callback is freed once it has run, so what it captured does not live as long as the state
+        if (((flags & VALUE) != 0) || (onClosed != 0)) {
+            _callback();
+        }
+        _callback = UniqueTask();
+    }
+}
+
+/**
+ * producing end of a one-shot channel. copies share one send, only the first Send of them delivers its value,
+ * so a sender can be captured by a copyable std::function. if all copies are gone without a Send, the callback
+ * is dropped at once without being run, or run with nullptr if it was set by ThenOrClosed.
+ */
+template<typename T>
+class OneShotSender {
+public:
+    OneShotSender() = default;
+    explicit OneShotSender(OneShotState<T>* state) : _state(state)
+    {}
+
+    ~OneShotSender()
+    {
+        Reset();
+    }
+
+    OneShotSender(const OneShotSender& other) : _state(other._state)
+    {
+        if (_state != nullptr) {
+            _state->AddSender();
+        }
+    }
+
+    OneShotSender& operator=(const OneShotSender& other)
+    {
+        if (this != &other) {
+            OneShotSender copy(other);
+            std::swap(_state, copy._state);
+        }
+        return *this;
+    }
+
+    OneShotSender(OneShotSender&& other) noexcept : _state(std::exchange(other._state, nullptr))
+    {}
+
+    OneShotSender& operator=(OneShotSender&& other) noexcept
+    {
+        if (this != &other) {
+            Reset();
+            _state = std::exchange(other._state, nullptr);
+        }
+        return *this;
+    }
+
+    // false if a value has been sent already, then value is not used
+    template<typename U = T>
+    bool Send(U&& value)
+    {
+        return (_state != nullptr) && _state->Send(std::forward<U>(value));
+    }
+
+    // the receiving side does not need the value any more, a producer which has not started can skip its work
+    bool IsCancelled() const
+    {
+        return (_state != nullptr) && _state->IsCancelled();
+    }
+
+    explicit operator bool() const
+    {
+        return _state != nullptr;
+    }
+
+private:
+    void Reset()
+    {
+        if (_state != nullptr) {
+            std::exchange(_state, nullptr)->ReleaseSender();
+        }
+    }
+
+    OneShotState<T>* _state {nullptr};
+};
+
+// keeps the state of a channel alive, only to cancel it
+template<typename T>
+class OneShotCanceller {
+public:
+    OneShotCanceller() = default;
+    explicit OneShotCanceller(OneShotState<T>* state) : _state(state)
+    {
+        if (_state != nullptr) {
+            _state->AddRef();
+        }
+    }
+
+    ~OneShotCanceller()
+    {
+        if (_state != nullptr) {
+            _state->Release();
+        }
+    }
+
+    OneShotCanceller(OneShotCanceller&& other) noexcept : _state(std::exchange(other._state, nullptr))
+    {}
+
+    OneShotCanceller(const OneShotCanceller&) = delete;
+    OneShotCanceller& operator=(const OneShotCanceller&) = delete;
+    OneShotCanceller& operator=(OneShotCanceller&&) = delete;
+
+    void Cancel()
+    {
+        if (_state != nullptr) {
+            _state->Cancel();
+        }
+    }
+
+private:
+    OneShotState<T>* _state {nullptr};
+};
+
+// consuming end of a one-shot channel, it takes one callback
+template<typename T>
+class OneShotReceiver {
+public:
+    OneShotReceiver() = default;
+    explicit OneShotReceiver(OneShotState<T>* state) : _state(state)
+    {}
+
+    ~OneShotReceiver()
+    {
+        Reset();
+    }
+
+    OneShotReceiver(OneShotReceiver&& other) noexcept : _state(std::exchange(other._state, nullptr))
+    {}
+
+    OneShotReceiver& operator=(OneShotReceiver&& other) noexcept
+    {
+        if (this != &other) {
+            Reset();
+            _state = std::exchange(other._state, nullptr);
+        }
+        return *this;
+    }
+
+    OneShotReceiver(const OneShotReceiver&) = delete;
+    OneShotReceiver& operator=(const OneShotReceiver&) = delete;
+
+    /**
+     * func(T&) runs once the value is there: inside this call if it is there already, otherwise inside Send
+     * on the sender thread. func should be short, or hand the value over to an executor.
+     */
+    template<typename F>
+    void Then(F&& func)
+    {
+        if (_state != nullptr) {
+            _state->Then(std::forward<F>(func));
+            Reset();
+        }
+    }
+
+    /**
+     * func(T*) runs like Then, and also once every sender is gone without a Send, with nullptr then, e.g. when
+     * the producer has skipped cancelled work. for a consumer which has to go on either way, like a coroutine.
+     */
+    template<typename F>
+    void ThenOrClosed(F&& func)
+    {
+        if (_state != nullptr) {
+            _state->ThenOrClosed(std::forward<F>(func));
+            Reset();
+        }
+    }
+
+    bool Ready() const
+    {
+        return (_state != nullptr) && _state->Ready();
+    }
+
+    // give up the value, the sender sees it by IsCancelled, and a value sent anyway is dropped
+    void Cancel()
+    {
+        if (_state != nullptr) {
+            _state->Cancel();
+            Reset();
+        }
+    }
+
+    // a handle by which the channel can still be cancelled after Then has consumed the receiver
+    OneShotCanceller<T> GetCanceller() const
+    {
+        return OneShotCanceller<T>(_state);
+    }
+
+    explicit operator bool() const
+    {
+        return _state != nullptr;
+    }
+
+private:
+    void Reset()
+    {
+        if (_state != nullptr) {
+            std::exchange(_state, nullptr)->Release();
+        }
+    }
+
+    OneShotState<T>* _state {nullptr};
+};
+
+template<typename T>
+std::pair<OneShotSender<T>, OneShotReceiver<T>> MakeOneShot()
+{
+    auto state = OneShotState<T>::New();
+    return {OneShotSender<T>(state), OneShotReceiver<T>(state)};
+}
+
+#endif // ONE_SHOT_H
@@ -0,0 +1,372 @@
+#ifndef TASK_H
+#define TASK_H
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+#include "one_shot.h"
+#include "thread_pool/thread_pool.h"
+
+template<typename T>
+class Task;
+
+/**
+ * what the promises of Task<T> and Task<void> share: the coroutine awaiting them, resumed when they finish.
+ * the awaiting side starts the task inside await_suspend, then the task and the awaiting side race on _done:
+ * - the task finishes before await_suspend returns: the awaiting coroutine is not suspended at all and goes on
+ *   on the same stack frame, so a loop of awaits finishing at once does not grow the stack.
+ * - the task suspends and finishes later on some thread: its final awaiter hands that thread over to the awaiting
+ *   coroutine by symmetric transfer, nothing is scheduled.
+ * the first case does not depend on tail calls, which compilers only emit for symmetric transfer when optimizing.
+ */
+class TaskPromiseBase {
+public:
+    struct FinalAwaiter {
+        bool await_ready() noexcept
+        {
+            return false;
+        }
+
+        template<typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+        {
+            auto& promise = handle.promise();
+            if (promise._done.exchange(1, std::memory_order_acq_rel) == 0) {
+                // await_suspend of the awaiting side has not returned yet, it goes on by itself
+                return std::noop_coroutine();
+            }
+            return (promise._continuation != nullptr) ? promise._continuation : std::noop_coroutine();
+        }
+
+        void await_resume() noexcept
+        {}
+    };
+
+    // lazy: nothing runs until the task is awaited
+    std::suspend_always initial_suspend() noexcept
+    {
+        return {};
+    }
+
+    FinalAwaiter final_suspend() noexcept
+    {
+        return {};
+    }
+
+    // kept for the awaiting coroutine, co_await rethrows it there
+    void unhandled_exception() noexcept
+    {
+        _exception = std::current_exception();
+    }
+
+    void SetContinuation(std::coroutine_handle<> continuation)
+    {
+        _continuation = continuation;
+    }
+
+    // called by the awaiting side after it has started the task, true if the task has finished already
+    bool MarkAwaited()
+    {
+        return _done.exchange(1, std::memory_order_acq_rel) != 0;
+    }
+
+protected:
+    void RethrowIfFailed() const
+    {
+        if (_exception != nullptr) {
+            std::rethrow_exception(_exception);
+        }
+    }
+
+private:
+    std::coroutine_handle<> _continuation;
+    std::exception_ptr _exception;
+    std::atomic<uint32_t> _done {0};
+};
+
+template<typename T>
+class TaskPromise : public TaskPromiseBase {
+public:
+    Task<T> get_return_object() noexcept;
+
+    template<typename U>
+    void return_value(U&& value)
+    {
+        _value.emplace(std::forward<U>(value));
+    }
+
+    T TakeValue()
+    {
+        RethrowIfFailed();
+        return std::move(*_value);
+    }
+
+private:
+    std::optional<T> _value;
+};
+
+template<>
+class TaskPromise<void> : public TaskPromiseBase {
+public:
+    Task<void> get_return_object() noexcept;
+
+    void return_void() noexcept
+    {}
+
+    void TakeValue()
+    {
+        RethrowIfFailed();
+    }
+};
+
+/**
+ * coroutine which produces one T. it starts when it is awaited, and when it finishes the thread goes straight
+ * to the awaiting coroutine, see TaskPromiseBase. the frame is only reached through the Task which owns it,
+ * so the compiler may put it in the frame of the awaiting coroutine instead of allocating it.
+ * a task is awaited once, by co_await std::move(task), which gives its value or rethrows what escaped from it.
+ */
+template<typename T>
+class Task {
+public:
+    using promise_type = TaskPromise<T>;
+
+    class Awaiter {
+    public:
+        explicit Awaiter(std::coroutine_handle<promise_type> handle) : _handle(handle)
+        {}
+
+        bool await_ready() noexcept
+        {
+            return false;
+        }
+
+        bool await_suspend(std::coroutine_handle<> awaiting) noexcept
+        {
+            _handle.promise().SetContinuation(awaiting);
+            _handle.resume();
+            return !_handle.promise().MarkAwaited();
+        }
+
+        T await_resume()
+        {
+            return _handle.promise().TakeValue();
+        }
+
+    private:
+        std::coroutine_handle<promise_type> _handle;
+    };
+
+    explicit Task(std::coroutine_handle<promise_type> handle) : _handle(handle)
+    {}
+
+    ~Task()
+    {
+        if (_handle) {
+            _handle.destroy();
+        }
+    }
+
+    Task(Task&& other) noexcept : _handle(std::exchange(other._handle, nullptr))
+    {}
+
+    Task& operator=(Task&& other) noexcept
+    {
+        if (this != &other) {
+            if (_handle) {
+                _handle.destroy();
+            }
+            _handle = std::exchange(other._handle, nullptr);
+        }
+        return *this;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    Awaiter operator co_await() && noexcept
+    {
+        return Awaiter(_handle);
+    }
+
+private:
+    std::coroutine_handle<promise_type> _handle;
+};
+
+template<typename T>
+Task<T> TaskPromise<T>::get_return_object() noexcept
+{
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() noexcept
+{
+    return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+/**
+ * co_await std::move(receiver) gives the value of a one-shot channel, or nullopt if every sender is gone without
+ * a Send, e.g. the producer skipped cancelled work. the coroutine goes on on the sender thread either way, so a
+ * channel which is never sent does not leave it suspended for good.
+ */
+template<typename T>
+class OneShotAwaiter {
+public:
+    explicit OneShotAwaiter(OneShotReceiver<T>&& receiver) : _receiver(std::move(receiver))
+    {}
+
+    bool await_ready() const
+    {
+        return _receiver.Ready();
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle)
+    {
+        _handle = handle;
+        _receiver.ThenOrClosed([this](T* value) {
+            if (value != nullptr) {
+                _value.emplace(std::move(*value));
+            }
+            // the side setting _arrived second resumes, so an outcome which is already there does not resume inline
+            if (_arrived.exchange(1, std::memory_order_acq_rel) != 0) {
+                _handle.resume();
+            }
+        });
+        return _arrived.exchange(1, std::memory_order_acq_rel) == 0;
+    }
+
+    std::optional<T> await_resume()
+    {
+        // the receiver is still there only if the value was ready at once
+        _receiver.Then([this](T& value) { _value.emplace(std::move(value)); });
+        return std::move(_value);
+    }
+
+private:
+    OneShotReceiver<T> _receiver;
+    std::coroutine_handle<> _handle;
+    std::optional<T> _value;
+    std::atomic<uint32_t> _arrived {0};
+};
+
+template<typename T>
+OneShotAwaiter<T> operator co_await(OneShotReceiver<T>&& receiver)
+{
+    return OneShotAwaiter<T>(std::move(receiver));
+}
+
+/**
+ * callable which resumes a suspended coroutine, also when it is destroyed without being called, e.g. dropped by a
+ * stopped pool or timer, so the coroutine is never left suspended for good. *called tells the coroutine which.
+ */
+class Resumer {
+public:
+    Resumer(std::coroutine_handle<> handle, bool* called) : _handle(handle), _called(called)
+    {}
+
+    ~Resumer()
+    {
+        if (_handle) {
+            _handle.resume();
+        }
+    }
+
+    Resumer(Resumer&& other) noexcept : _handle(std::exchange(other._handle, nullptr)), _called(other._called)
+    {}
+
+    Resumer(const Resumer&) = delete;
+    Resumer& operator=(const Resumer&) = delete;
+    Resumer& operator=(Resumer&&) = delete;
+
+    void operator()()
+    {
+        *_called = true;
+        std::exchange(_handle, nullptr).resume();
+    }
+
+private:
+    std::coroutine_handle<> _handle;
+    bool* _called;
+};
+
+/**
+ * co_await ScheduleOn(pool) moves the rest of the coroutine onto a worker of pool, and gives true. if pool refuses
+ * the task, or drops it without running, e.g. it is left in the queue when the pool stops, the coroutine goes on
+ * on the thread which dropped it and gets false. it should stop then instead of going on with the work.
+ */
+class ScheduleOn {
+public:
+    explicit ScheduleOn(ThreadPool& executor) : _executor(executor)
+    {}
+
+    bool await_ready() noexcept
+    {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        // the coroutine may be running already when AddTask returns, on a worker or on this thread if it was refused,
+        // members are not touched after it
+        (void)_executor.AddTask(Resumer(handle, &_onPool));
+    }
+
+    bool await_resume() noexcept
+    {
+        return _onPool;
+    }
+
+private:
+    ThreadPool& _executor;
+    bool _onPool {false};
+};
+
+// coroutine which starts at once and never waits for anyone to await it, it frees its frame when it is done
+struct DetachedTask {
+    struct promise_type {
+        DetachedTask get_return_object() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never final_suspend() noexcept
+        {
+            return {};
+        }
+
+        void return_void() noexcept
+        {}
+
+        void unhandled_exception() noexcept
+        {
+            std::terminate();
+        }
+    };
+};
+
+template<typename T>
+DetachedTask RunToChannel(Task<T> task, OneShotSender<T> sender)
+{
+    try {
+        (void)sender.Send(co_await std::move(task));
+    } catch (...) {
+        // the sender is dropped, the receiver sees the channel closed without a value
+    }
+}
+
+// starts task now, its result arrives by the returned receiver, nothing arrives if the task throws
+template<typename T>
+OneShotReceiver<T> Launch(Task<T> task)
+{
+    auto [sender, receiver] = MakeOneShot<T>();
+    RunToChannel(std::move(task), std::move(sender));
+    return std::move(receiver);
+}
+
+#endif // TASK_H
@@ -0,0 +1,83 @@
+#include "timer_service.h"
+
+TimerService::TimerService()
+{
+    _thread = std::thread(&TimerService::TimerLoop, this);
+}
+
+TimerService::~TimerService()
+{
+    {
+        std::lock_guard<std::mutex> lock {_lock};
+        _stopped = true;
+        _cv.notify_one();
+    }
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+    // moved out first, a callback may cancel other timers when it is destroyed
+    auto timers = std::move(_timers);
+}
+
+TimerService::TimerId TimerService::ScheduleAt(Clock::time_point deadline, UniqueTask func)
+{
+    std::unique_lock<std::mutex> lock {_lock};
+    TimerId id {deadline, _nextSeq++};
+    if (_stopped) {
+        // e.g. scheduled by a dropped callback, it is dropped too, outside the lock like a cancelled one
+        lock.unlock();
+        return id;
+    }
+    auto it = _timers.emplace(id, std::move(func)).first;
+    // the thread only has to wake up earlier if this is the new earliest deadline
+    if (it == _timers.begin()) {
+        _cv.notify_one();
+    }
+    return id;
+}
+
+bool TimerService::Cancel(const TimerId& id)
+{
+    UniqueTask func;
+    {
+        std::lock_guard<std::mutex> lock {_lock};
+        auto it = _timers.find(id);
+        if (it == _timers.end()) {
+            return false;
+        }
+        func = std::move(it->second);
+        _timers.erase(it);
+    }
+    // what the callback captured is freed outside the lock, it may cancel other timers in its destructor
+    return true;
+}
+
+size_t TimerService::GetPending()
+{
+    std::lock_guard<std::mutex> lock {_lock};
+    return _timers.size();
+}
+
+void TimerService::TimerLoop()
+{
+    std::unique_lock<std::mutex> lock {_lock};
+    while (!_stopped) {
+        if (_timers.empty()) {
+            _cv.wait(lock);
+            continue;
+        }
+        auto first = _timers.begin();
+        if (Clock::now() < first->first.first) {
+            // woken up earlier by a new earliest timer or by stopping, the loop looks again
+            _cv.wait_until(lock, first->first.first);
+            continue;
+        }
+
+        auto func = std::move(first->second);
+        _timers.erase(first);
+        lock.unlock();
+        func();
+        func = UniqueTask();
+        lock.lock();
+    }
+}
@@ -0,0 +1,157 @@
+#ifndef TIMER_SERVICE_H
+#define TIMER_SERVICE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include "one_shot.h"
+#include "task.h"
+#include "thread_pool/unique_task.h"
+
+/**
+ * one thread for all timers of the process. timers are kept sorted by deadline, and the thread sleeps until the
+ * earliest one, so thousands of pending deadlines cost one thread and one map node each.
+ * callbacks run on the timer thread one after another, they should be short, e.g. resume a coroutine which
+ * moves on to an executor by ScheduleOn, or send a value by a channel.
+ */
+class TimerService {
+public:
+    using Clock = std::chrono::steady_clock;
+    // deadline and sequence number, timers with the same deadline fire in the order they were added
+    using TimerId = std::pair<Clock::time_point, uint64_t>;
+
+    TimerService();
+    // timers which have not fired are dropped with what their callbacks captured, and later ones at once
+    ~TimerService();
+
+    TimerService(const TimerService&) = delete;
+    TimerService& operator=(const TimerService&) = delete;
+    TimerService(const TimerService&&) = delete;
+    TimerService& operator=(const TimerService&&) = delete;
+
+    TimerId ScheduleAt(Clock::time_point deadline, UniqueTask func);
+
+    template<typename Rep, typename Period>
+    TimerId ScheduleAfter(std::chrono::duration<Rep, Period> delay, UniqueTask func)
+    {
+        return ScheduleAt(Clock::now() + std::chrono::duration_cast<Clock::duration>(delay), std::move(func));
+    }
+
+    // false if the timer has fired already or is firing now
+    bool Cancel(const TimerId& id);
+
+    size_t GetPending();
+
+private:
+    void TimerLoop();
+
+    std::mutex _lock;
+    std::condition_variable _cv;
+    std::map<TimerId, UniqueTask> _timers;
+    uint64_t _nextSeq {0};
+    bool _stopped {false};
+    std::thread _thread;
+};
+
+/**
+ * co_await SleepFor(timer, delay): the coroutine goes on on the timer thread after delay, no thread sleeps, and
+ * gets true. if the timer service is destroyed first, it goes on on the destroying thread at once and gets false.
+ */
+class SleepFor {
+public:
+    template<typename Rep, typename Period>
+    SleepFor(TimerService& timer, std::chrono::duration<Rep, Period> delay) :
+        _timer(timer), _delay(std::chrono::duration_cast<TimerService::Clock::duration>(delay))
+    {}
+
+    bool await_ready() const noexcept
+    {
+        return _delay <= TimerService::Clock::duration::zero();
+    }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        // the coroutine may be running already when ScheduleAfter returns, members are not touched after it
+        (void)_timer.ScheduleAfter(_delay, Resumer(handle, &_elapsed));
+    }
+
+    bool await_resume() noexcept
+    {
+        return _elapsed || await_ready();
+    }
+
+private:
+    TimerService& _timer;
+    TimerService::Clock::duration _delay;
+    bool _elapsed {false};
+};
+
+enum class TimeoutStatus
+{
+    OK,
+    TIMEOUT,
+};
+
+// value is only there with OK
+template<typename T>
+struct Timed {
+    TimeoutStatus status;
+    std::optional<T> value;
+};
+
+/**
+ * the value of input if it arrives before deadline, otherwise TIMEOUT at deadline. whichever comes first wins:
+ * a value cancels the timer, and a timeout cancels input, so its producer can skip its work and a late value
+ * is dropped.
+ */
+template<typename T>
+OneShotReceiver<Timed<T>> WithTimeout(TimerService& timer, OneShotReceiver<T> input,
+                                      TimerService::Clock::time_point deadline)
+{
+    struct State {
+        State(TimerService& timer, OneShotSender<Timed<T>> sender, OneShotCanceller<T> canceller) :
+            timer(timer), sender(std::move(sender)), canceller(std::move(canceller))
+        {}
+
+        TimerService& timer;
+        std::atomic<uint32_t> decided {0};
+        OneShotSender<Timed<T>> sender;
+        OneShotCanceller<T> canceller;
+        TimerService::TimerId timerId;
+    };
+
+    auto [sender, receiver] = MakeOneShot<Timed<T>>();
+    auto state = std::make_shared<State>(timer, std::move(sender), input.GetCanceller());
+    // the timer may fire at once, it does not read timerId, the value callback which does is set afterwards
+    state->timerId = timer.ScheduleAt(deadline, [state]() {
+        if (state->decided.exchange(1, std::memory_order_acq_rel) == 0) {
+            state->canceller.Cancel();
+            (void)state->sender.Send(Timed<T> {TimeoutStatus::TIMEOUT, std::nullopt});
+        }
+    });
+    input.Then([state](T& value) {
+        if (state->decided.exchange(1, std::memory_order_acq_rel) == 0) {
+            // frees the timer, and with it the reference it holds to state, long before deadline
+            (void)state->timer.Cancel(state->timerId);
+            (void)state->sender.Send(Timed<T> {TimeoutStatus::OK, std::move(value)});
+        }
+    });
+    return std::move(receiver);
+}
+
+// the task starts now, it runs to its end even after a timeout, only its result is dropped then
+template<typename T>
+OneShotReceiver<Timed<T>> WithTimeout(TimerService& timer, Task<T> task, TimerService::Clock::time_point deadline)
+{
+    return WithTimeout(timer, Launch(std::move(task)), deadline);
+}
+
+#endif // TIMER_SERVICE_H
@@ -0,0 +1,100 @@
+#ifndef WHEN_ALL_H
+#define WHEN_ALL_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+#include "one_shot.h"
+
+/**
+ * combinators over one-shot channels. no thread waits: every input gets a callback which counts down a shared
+ * atomic, and the input which completes the result sends it on its own thread.
+ * if an input is never sent, e.g. its producer is dropped, the combined result is never sent either and its
+ * callback is dropped, the same as for a single channel.
+ */
+
+// values of all inputs in their order, once the last of them has arrived
+template<typename T>
+OneShotReceiver<std::vector<T>> WhenAll(std::vector<OneShotReceiver<T>> inputs)
+{
+    struct State {
+        explicit State(size_t num, OneShotSender<std::vector<T>> sender) :
+            values(num), remaining(num), sender(std::move(sender))
+        {}
+
+        std::vector<std::optional<T>> values;
+        std::atomic<size_t> remaining;
+        OneShotSender<std::vector<T>> sender;
+    };
+
+    auto [sender, receiver] = MakeOneShot<std::vector<T>>();
+    if (inputs.empty()) {
+        (void)sender.Send(std::vector<T>());
+        return std::move(receiver);
+    }
+
+    auto state = std::make_shared<State>(inputs.size(), std::move(sender));
+    for (size_t i = 0; i < inputs.size(); i++) {
+        inputs[i].Then([state, i](T& value) {
+            state->values[i].emplace(std::move(value));
+            // acq_rel: the last input sees the values written by all others
+            if (state->remaining.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+                return;
+            }
+            std::vector<T> values;
+            values.reserve(state->values.size());
+            for (auto& one : state->values) {
+                values.push_back(std::move(*one));
+            }
+            (void)state->sender.Send(std::move(values));
+        });
+    }
+    return std::move(receiver);
+}
+
+/**
+ * index and value of the first input to arrive. the other inputs are cancelled then, so producers which have
+ * not started skip their work (see OneShotSender::IsCancelled), and values which arrive later are dropped.
+ * with hedged requests, the same request sent twice, the slower copy costs little and the tail latency is the
+ * lower one of the two.
+ */
+template<typename T>
+OneShotReceiver<std::pair<size_t, T>> WhenAny(std::vector<OneShotReceiver<T>> inputs)
+{
+    struct State {
+        explicit State(OneShotSender<std::pair<size_t, T>> sender) : sender(std::move(sender))
+        {}
+
+        std::atomic<uint32_t> decided {0};
+        OneShotSender<std::pair<size_t, T>> sender;
+        std::vector<OneShotCanceller<T>> cancellers;
+    };
+
+    auto [sender, receiver] = MakeOneShot<std::pair<size_t, T>>();
+    auto state = std::make_shared<State>(std::move(sender));
+    // all cancellers are there before the first callback can run, the winner only reads them
+    state->cancellers.reserve(inputs.size());
+    for (const auto& input : inputs) {
+        state->cancellers.push_back(input.GetCanceller());
+    }
+
+    for (size_t i = 0; i < inputs.size(); i++) {
+        inputs[i].Then([state, i](T& value) {
+            if (state->decided.exchange(1, std::memory_order_acq_rel) != 0) {
+                return;
+            }
+            for (size_t j = 0; j < state->cancellers.size(); j++) {
+                if (j != i) {
+                    state->cancellers[j].Cancel();
+                }
+            }
+            (void)state->sender.Send(std::pair<size_t, T>(i, std::move(value)));
+        });
+    }
+    return std::move(receiver);
+}
+
+#endif // WHEN_ALL_H
@@ -5,7 +5,7 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include "mmap_utils.h"
-#include "utils.h"
+#include "utils/utils.h"
 
 using std::string;
 
@@ -10,7 +10,9 @@
 #include <stdlib.h>
 #include <unistd.h>
 
-#include "utils.h"
+#include "utils/metrics.h"
+#include "utils/profiler.h"
+#include "utils/utils.h"
 
 constexpr int32_t INVALID_INT32 = -1;
 
@@ -165,6 +167,9 @@ void ExpandFile(int32_t incSize, int32_t fd)
  */
 bool EnlargeFileMmap(FileMmap *fMmmpRec, int32_t incSize)
 {
+    PROFILE_ZONE("EnlargeFileMmap");
+    static auto &enlargeNs = Metrics::GetHistogram("mmap.enlarge_ns");
+    Metrics::ScopedLatency latency(enlargeNs);
     if ((fMmmpRec == nullptr) || (incSize <= 0)) {
         PRINT_ERROR("invalid fmmap(%p) or increase size(%u).", fMmmpRec, incSize);
         return false;
@@ -201,6 +206,11 @@ bool EnlargeFileMmap(FileMmap *fMmmpRec, int32_t incSize)
     fMmmpRec->buffSize = oldSize + incSize;
     fMmmpRec->freeBuff = fMmmpRec->buff + oldSize;
     fMmmpRec->freeBuffSize = incSize;
+    PROFILE_PLOT("file mmap size", fMmmpRec->buffSize);
+    static auto &enlarged = Metrics::GetCounter("mmap.enlarged");
+    static auto &enlargedBytes = Metrics::GetCounter("mmap.enlarged_bytes");
+    enlarged.Add(1);
+    enlargedBytes.Add(incSize);
 
     return true;
 }
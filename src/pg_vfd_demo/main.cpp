@@ -1,9 +1,12 @@
 #include "vfd.h"
+#include "metrics.h"
 
 using namespace std;
 
 int main()
 {
+    // the last snapshot is written when it goes out of scope
+    MetricsExporter exporter("vfd_metrics.json", chrono::seconds(1), Metrics::Format::JSON);
     InitFileAccess();
 
     PathNameOpenFile("files/1");
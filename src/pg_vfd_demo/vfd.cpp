@@ -5,6 +5,8 @@
 
 #include "vfd.h"
 #include "utils.h"
+#include "metrics.h"
+#include "profiler.h"
 
 typedef struct vfd {
     FILE *fd;
@@ -44,6 +46,7 @@ void InitFileAccess()
     VfdCache[VFD_CACHE_SIZE - 1].nextFree = 0;
     VfdCache[0].nextFree = 1;
     openFiles = 0;
+    Metrics::GetGauge("vfd.lru_size").Set(LRU_SIZE);
 }
 
 static File AllocateVfd()
@@ -85,6 +88,9 @@ static void LruDelete(File file)
 
 File PathNameOpenFile(const char *fileName)
 {
+    PROFILE_ZONE("PathNameOpenFile");
+    static auto &openNs = Metrics::GetHistogram("vfd.open_ns");
+    Metrics::ScopedLatency latency(openNs);
     Vfd		   *vfdP;
     File        file;
 
@@ -113,6 +119,11 @@ File PathNameOpenFile(const char *fileName)
     VfdCache[vfdP->lruLessRecently].lruMoreRecently = file;
 
     openFiles++;
+    PROFILE_PLOT("vfd open files", openFiles);
+    static auto &opened = Metrics::GetCounter("vfd.opened");
+    static auto &openFilesGauge = Metrics::GetGauge("vfd.open_files");
+    opened.Add(1);
+    openFilesGauge.Set(openFiles);
     return file;
 }
 
@@ -121,5 +132,7 @@ static void ReleaseLruFiles()
     while(openFiles >= LRU_SIZE) {
         PRINT_INFO("LRU pool is full, need to clear file: %s.", VfdCache[VfdCache[0].lruMoreRecently].fileName);
         LruDelete(VfdCache[0].lruMoreRecently);
+        static auto &evicted = Metrics::GetCounter("vfd.lru_evicted");
+        evicted.Add(1);
     }
 }
\ No newline at end of file
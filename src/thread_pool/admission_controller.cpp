@@ -0,0 +1,69 @@
+#include "admission_controller.h"
+#include <cmath>
+
+bool AdmissionController::Admit(Clock::time_point now)
+{
+    // fast path: nothing to do while queue is healthy
+    if (_ctrlStat.load(std::memory_order_relaxed) != CtrlStat::DROPPING) {
+        _admitted.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock {_lock};
+    if ((_ctrlStat.load() == CtrlStat::DROPPING) && (now >= _dropNext)) {
+        _dropCount++;
+        _dropNext = now + ControlLaw(_dropCount);
+        _shed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    _admitted.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void AdmissionController::OnDequeue(Clock::duration sojourn, Clock::time_point now)
+{
+    if ((sojourn < _target) && (_ctrlStat.load(std::memory_order_relaxed) == CtrlStat::NORMAL)) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock {_lock};
+    if (sojourn < _target) {
+        _ctrlStat.store(CtrlStat::NORMAL);
+        return;
+    }
+
+    auto ctrlStat = _ctrlStat.load();
+    if (ctrlStat == CtrlStat::NORMAL) {
+        _firstAboveTime = now + _interval;
+        _ctrlStat.store(CtrlStat::ABOVE_TARGET);
+        return;
+    }
+
+    if ((ctrlStat == CtrlStat::ABOVE_TARGET) && (now >= _firstAboveTime)) {
+        // if it was dropping not long ago, go on with a drop rate close to the last one
+        constexpr uint32_t COUNT_DECAY = 2;
+        constexpr uint32_t REUSE_INTERVALS = 16;
+        bool recentlyDropped = (_dropCount > COUNT_DECAY) && (now - _dropNext < _interval * REUSE_INTERVALS);
+        _dropCount = recentlyDropped ? (_dropCount - COUNT_DECAY) : 0;
+        _dropNext = now;
+        _ctrlStat.store(CtrlStat::DROPPING);
+    }
+}
+
+AdmissionController::Stats AdmissionController::GetStats() const
+{
+    return {_admitted.load(std::memory_order_relaxed), _shed.load(std::memory_order_relaxed)};
+}
+
+double AdmissionController::GetShedRate() const
+{
+    auto stats = GetStats();
+    uint64_t total = stats.admitted + stats.shed;
+    return (total == 0) ? 0.0 : static_cast<double>(stats.shed) / static_cast<double>(total);
+}
+
+AdmissionController::Clock::duration AdmissionController::ControlLaw(uint32_t count) const
+{
+    return std::chrono::duration_cast<Clock::duration>(_interval / std::sqrt(static_cast<double>(count)));
+}
@@ -0,0 +1,65 @@
+#ifndef SMALL_DEMOS_ADMISSION_CONTROLLER_H
+#define SMALL_DEMOS_ADMISSION_CONTROLLER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+/**
+ * CoDel-style admission control for a task queue.
+ * workers report how long each task has waited in the queue. once the waiting time stays above target for a
+ * whole interval, the controller starts to shed new tasks, and sheds them more and more frequently
+ * (interval / sqrt(count)) until the waiting time goes below target again.
+ */
+class AdmissionController {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Stats {
+        uint64_t admitted;
+        uint64_t shed;
+    };
+
+    AdmissionController(Clock::duration target, Clock::duration interval) : _target(target), _interval(interval)
+    {}
+    ~AdmissionController() = default;
+
+    AdmissionController(const AdmissionController&) = delete;
+    AdmissionController& operator=(const AdmissionController&) = delete;
+    AdmissionController(const AdmissionController&&) = delete;
+    AdmissionController& operator=(const AdmissionController&&) = delete;
+
+    // called before a task is put into queue, false means the task should be rejected
+    bool Admit(Clock::time_point now);
+    // called when a task is taken out of queue
+    void OnDequeue(Clock::duration sojourn, Clock::time_point now);
+
+    Stats GetStats() const;
+    // ratio of shed tasks to all tasks which have asked for admission
+    double GetShedRate() const;
+
+private:
+    enum class CtrlStat
+    {
+        NORMAL,        // queue delay is below target
+        ABOVE_TARGET,  // queue delay is above target, but not for a whole interval yet
+        DROPPING,      // queue delay has been above target for a whole interval, start to shed
+    };
+
+    Clock::duration ControlLaw(uint32_t count) const;
+
+    Clock::duration _target;
+    Clock::duration _interval;
+    std::atomic<CtrlStat> _ctrlStat {CtrlStat::NORMAL};
+    std::atomic<uint64_t> _admitted {0};
+    std::atomic<uint64_t> _shed {0};
+
+    // protected by _lock, only touched when queue delay is above target
+    std::mutex _lock;
+    Clock::time_point _firstAboveTime;
+    Clock::time_point _dropNext;
+    uint32_t _dropCount {0};
+};
+
+#endif  // SMALL_DEMOS_ADMISSION_CONTROLLER_H
@@ -0,0 +1,107 @@
+#ifndef SMALL_DEMOS_BOUNDED_CHANNEL_H
+#define SMALL_DEMOS_BOUNDED_CHANNEL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/**
+ * lock-free bounded multi-producer/multi-consumer channel.
+ * every cell carries a sequence number which tells whether it is ready to be written or to be read,
+ * so producers and consumers only contend on their own cursor and never block each other.
+ */
+template<typename T>
+class BoundedChannel {
+public:
+    explicit BoundedChannel(size_t capacity)
+    {
+        // round up to power of 2, so the cell index can be got by mask instead of modulo
+        size_t realCapacity = 2;
+        while (realCapacity < capacity) {
+            realCapacity <<= 1;
+        }
+
+        _mask = realCapacity - 1;
+        _cells = std::make_unique<Cell[]>(realCapacity);
+        for (size_t i = 0; i < realCapacity; i++) {
+            _cells[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+    ~BoundedChannel() = default;
+
+    BoundedChannel(const BoundedChannel&) = delete;
+    BoundedChannel& operator=(const BoundedChannel&) = delete;
+    BoundedChannel(const BoundedChannel&&) = delete;
+    BoundedChannel& operator=(const BoundedChannel&&) = delete;
+
+    bool TryPush(T&& value);
+    bool TryPop(T& value);
+
+    size_t Capacity() const
+    {
+        return _mask + 1;
+    }
+
+private:
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+    struct Cell {
+        std::atomic<size_t> seq;
+        T data;
+    };
+
+    std::unique_ptr<Cell[]> _cells;
+    size_t _mask {0};
+    // keep cursors in different cache lines to avoid false sharing between producers and consumers
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> _enqueuePos {0};
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> _dequeuePos {0};
+};
+
+template<typename T>
+bool BoundedChannel<T>::TryPush(T&& value)
+{
+    size_t pos = _enqueuePos.load(std::memory_order_relaxed);
+    while (true) {
+        Cell& cell = _cells[pos & _mask];
+        size_t seq = cell.seq.load(std::memory_order_acquire);
+        auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            if (_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                cell.data = std::move(value);
+                cell.seq.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            // the cell has not been consumed since last round, channel is full
+            return false;
+        } else {
+            pos = _enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+template<typename T>
+bool BoundedChannel<T>::TryPop(T& value)
+{
+    size_t pos = _dequeuePos.load(std::memory_order_relaxed);
+    while (true) {
+        Cell& cell = _cells[pos & _mask];
+        size_t seq = cell.seq.load(std::memory_order_acquire);
+        auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+        if (diff == 0) {
+            if (_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                value = std::move(cell.data);
+                cell.seq.store(pos + _mask + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            // nothing has been written into the cell yet, channel is empty
+            return false;
+        } else {
+            pos = _dequeuePos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+#endif  // SMALL_DEMOS_BOUNDED_CHANNEL_H
@@ -0,0 +1,73 @@
+#include "executor_registry.h"
+#include <algorithm>
+#include <thread>
+
+ExecutorRegistry::ExecutorRegistry(uint32_t maxThreads, uint32_t cpuThreads, uint32_t ioThreads) :
+    _maxThreads(maxThreads)
+{
+    // the two default pools take one thread at least, whatever maxThreads is
+    _maxThreads = std::max(_maxThreads, 2U);
+    cpuThreads = std::max(std::min(cpuThreads, _maxThreads - 1), 1U);
+    (void)Register(CPU_EXECUTOR, ExecutorKind::CPU, cpuThreads, DEFAULT_WAIT_QUEUE_SIZE);
+    ioThreads = std::max(std::min(ioThreads, _maxThreads - _threadNum), 1U);
+    (void)Register(IO_EXECUTOR, ExecutorKind::BLOCKING, ioThreads, DEFAULT_WAIT_QUEUE_SIZE);
+
+    _cpu = Get(CPU_EXECUTOR);
+    _io = Get(IO_EXECUTOR);
+}
+
+ExecutorRegistry::~ExecutorRegistry()
+{
+    std::lock_guard<std::mutex> lock {_lock};
+    for (auto& [name, pool] : _pools) {
+        pool->Destroy();
+    }
+}
+
+ExecutorRegistry& ExecutorRegistry::Default()
+{
+    // blocking pools may use as many threads as cores on top of the cpu pool
+    static uint32_t cores = std::max(std::thread::hardware_concurrency(), 1U);
+    static ExecutorRegistry registry(cores * 2 + DEFAULT_IO_THREADS, cores, DEFAULT_IO_THREADS);
+    return registry;
+}
+
+bool ExecutorRegistry::Register(const std::string& name, ExecutorKind kind, uint32_t poolSize,
+                                uint32_t waitQueueSize)
+{
+    // more cpu workers than cores only add context switches
+    if (kind == ExecutorKind::CPU) {
+        poolSize = std::min(poolSize, std::max(std::thread::hardware_concurrency(), 1U));
+    }
+
+    std::lock_guard<std::mutex> lock {_lock};
+    if (_pools.count(name) != 0) {
+        PRINT_ERROR("executor(%s) has been registered!", name.c_str());
+        return false;
+    }
+
+    auto pool = std::make_unique<ThreadPool>(poolSize, waitQueueSize);
+    if (_threadNum + pool->GetPoolSize() > _maxThreads) {
+        PRINT_ERROR("executor(%s) needs %u threads, only %u left!", name.c_str(), pool->GetPoolSize(),
+                    _maxThreads - _threadNum);
+        return false;
+    }
+
+    _threadNum += pool->GetPoolSize();
+    pool->Init();
+    _pools.emplace(name, std::move(pool));
+    return true;
+}
+
+ThreadPool* ExecutorRegistry::Get(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock {_lock};
+    auto it = _pools.find(name);
+    return (it == _pools.end()) ? nullptr : it->second.get();
+}
+
+uint32_t ExecutorRegistry::GetThreadNum() const
+{
+    std::lock_guard<std::mutex> lock {_lock};
+    return _threadNum;
+}
@@ -0,0 +1,149 @@
+#ifndef SMALL_DEMOS_EXECUTOR_REGISTRY_H
+#define SMALL_DEMOS_EXECUTOR_REGISTRY_H
+
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include "thread_pool.h"
+
+enum class ExecutorKind
+{
+    CPU,       // never more workers than cores, tasks should not block
+    BLOCKING,  // for tasks waiting on file or network I/O, may have more workers than cores
+};
+
+// type of then(blocking()), or of then() if blocking returns void
+template<typename Blocking, typename Then>
+struct OffloadResult {
+    using BlockingRes = std::invoke_result_t<Blocking&>;
+    using Type = typename std::conditional_t<std::is_void_v<BlockingRes>, std::invoke_result<Then&>,
+                                             std::invoke_result<Then&, BlockingRes>>::type;
+};
+
+/**
+ * named thread pools of a process, so blocking I/O tasks run in their own pool instead of starving CPU tasks.
+ * the sum of workers of all pools is bounded by maxThreads, registering a pool beyond it fails.
+ * "cpu" (sized to the hardware) and "io" are always registered.
+ */
+class ExecutorRegistry {
+public:
+    static constexpr const char* CPU_EXECUTOR = "cpu";
+    static constexpr const char* IO_EXECUTOR = "io";
+
+    ExecutorRegistry(uint32_t maxThreads, uint32_t cpuThreads, uint32_t ioThreads);
+    ~ExecutorRegistry();
+
+    ExecutorRegistry(const ExecutorRegistry&) = delete;
+    ExecutorRegistry& operator=(const ExecutorRegistry&) = delete;
+    ExecutorRegistry(const ExecutorRegistry&&) = delete;
+    ExecutorRegistry& operator=(const ExecutorRegistry&&) = delete;
+
+    // registry of the process, its cpu pool has one worker for each core
+    static ExecutorRegistry& Default();
+
+    // false if the name is used or there are not enough threads left
+    bool Register(const std::string& name, ExecutorKind kind, uint32_t poolSize, uint32_t waitQueueSize);
+    // nullptr if there is no such pool, the pool lives as long as the registry
+    ThreadPool* Get(const std::string& name);
+
+    ThreadPool& Cpu()
+    {
+        return *_cpu;
+    }
+
+    ThreadPool& Io()
+    {
+        return *_io;
+    }
+
+    uint32_t GetThreadNum() const;
+
+    /**
+     * run blocking on the io pool, then run then(result of blocking) on the cpu pool.
+     * the returned future gets the result of then, it is invalid if the io pool refuses the task.
+     */
+    template<typename Blocking, typename Then>
+    auto OffloadBlocking(Blocking blocking, Then then) -> std::future<typename OffloadResult<Blocking, Then>::Type>;
+
+private:
+    static constexpr uint32_t DEFAULT_IO_THREADS = 4;
+    static constexpr uint32_t DEFAULT_WAIT_QUEUE_SIZE = 10;
+
+    template<typename R, typename F>
+    static void SetPromise(std::promise<R>& promise, F&& func)
+    {
+        if constexpr (std::is_void_v<R>) {
+            func();
+            promise.set_value();
+        } else {
+            promise.set_value(func());
+        }
+    }
+
+    uint32_t _maxThreads;
+    mutable std::mutex _lock;
+    std::map<std::string, std::unique_ptr<ThreadPool>> _pools;
+    uint32_t _threadNum {0};
+    ThreadPool* _cpu {nullptr};
+    ThreadPool* _io {nullptr};
+};
+
+template<typename Blocking, typename Then>
+auto ExecutorRegistry::OffloadBlocking(Blocking blocking, Then then)
+    -> std::future<typename OffloadResult<Blocking, Then>::Type>
+{
+    using ResType = typename OffloadResult<Blocking, Then>::Type;
+    using BlockingRes = typename OffloadResult<Blocking, Then>::BlockingRes;
+
+    // shared by the io task and the cpu task, so the io worker can still finish it if the cpu pool refuses
+    struct State {
+        std::promise<ResType> promise;
+        Then then;
+        std::conditional_t<std::is_void_v<BlockingRes>, bool, std::optional<BlockingRes>> value {};
+    };
+
+    auto state = std::make_shared<State>(State {std::promise<ResType>(), std::move(then)});
+    auto result = state->promise.get_future();
+    // an exception of blocking or then goes to the caller by the future, the futures of the pools are not read
+    auto resume = [state]() {
+        try {
+            if constexpr (std::is_void_v<BlockingRes>) {
+                SetPromise(state->promise, [&state]() { return state->then(); });
+            } else {
+                SetPromise(state->promise, [&state]() { return state->then(std::move(*state->value)); });
+            }
+        } catch (...) {
+            state->promise.set_exception(std::current_exception());
+        }
+    };
+
+    auto ioTask = [this, state, resume, blocking = std::move(blocking)]() mutable {
+        try {
+            if constexpr (std::is_void_v<BlockingRes>) {
+                blocking();
+            } else {
+                state->value.emplace(blocking());
+            }
+        } catch (...) {
+            state->promise.set_exception(std::current_exception());
+            return;
+        }
+
+        if (!_cpu->AddTask(resume).valid()) {
+            resume();
+        }
+    };
+
+    if (!_io->AddTask(std::move(ioTask)).valid()) {
+        return std::future<ResType>();
+    }
+    return result;
+}
+
+#endif  // SMALL_DEMOS_EXECUTOR_REGISTRY_H
@@ -0,0 +1,385 @@
+#include "io_executor.h"
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+namespace {
+constexpr uint64_t STOP_USER_DATA = 0;
+
+int IoUringSetup(uint32_t entries, io_uring_params* params)
+{
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int IoUringEnter(int fd, uint32_t toSubmit, uint32_t minComplete, uint32_t flags)
+{
+    int ret;
+    do {
+        ret = static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+    } while ((ret < 0) && (errno == EINTR));
+    return ret;
+}
+
+// ring indexes are shared with the kernel, they are only accessed by acquire/release like liburing does
+uint32_t LoadAcquire(uint32_t* ptr)
+{
+    return std::atomic_ref<uint32_t>(*ptr).load(std::memory_order_acquire);
+}
+
+void StoreRelease(uint32_t* ptr, uint32_t value)
+{
+    std::atomic_ref<uint32_t>(*ptr).store(value, std::memory_order_release);
+}
+}  // namespace
+
+// mapped queues of one io_uring instance, see io_uring_setup(2)
+struct IoExecutor::Ring {
+    ~Ring()
+    {
+        if (sqes != MAP_FAILED) {
+            munmap(sqes, sqesSize);
+        }
+        if ((cqRing != MAP_FAILED) && (cqRing != sqRing)) {
+            munmap(cqRing, cqRingSize);
+        }
+        if (sqRing != MAP_FAILED) {
+            munmap(sqRing, sqRingSize);
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    int fd {-1};
+    void* sqRing {MAP_FAILED};
+    size_t sqRingSize {0};
+    void* cqRing {MAP_FAILED};
+    size_t cqRingSize {0};
+    io_uring_sqe* sqes {static_cast<io_uring_sqe*>(MAP_FAILED)};
+    size_t sqesSize {0};
+
+    uint32_t sqEntries {0};
+    uint32_t* sqHead {nullptr};
+    uint32_t* sqTail {nullptr};
+    uint32_t* sqMask {nullptr};
+    uint32_t* sqArray {nullptr};
+    uint32_t* cqHead {nullptr};
+    uint32_t* cqTail {nullptr};
+    uint32_t* cqMask {nullptr};
+    io_uring_cqe* cqes {nullptr};
+};
+
+IoExecutor::IoExecutor(ThreadPool& pool, uint32_t queueDepth, uint32_t blockingThreads, Backend backend) :
+    _pool(pool)
+{
+    if ((backend == Backend::AUTO) && SetupRing(std::max(queueDepth, 2U))) {
+        _completionThread = std::thread(&IoExecutor::CompletionLoop, this);
+        return;
+    }
+
+    for (uint32_t i = 0; i < std::max(blockingThreads, 1U); i++) {
+        _blockingThreads.emplace_back(&IoExecutor::BlockingLoop, this);
+    }
+}
+
+IoExecutor::~IoExecutor()
+{
+    // requests already accepted are still finished, then the threads leave
+    std::unique_lock<std::mutex> lock {_lock};
+    _stopping = true;
+    if (_ring != nullptr) {
+        // the completion thread may sleep in the kernel, a nop wakes it up
+        PushToRing(nullptr);
+        lock.unlock();
+        Flush();
+        _completionThread.join();
+        return;
+    }
+
+    lock.unlock();
+    _cv.notify_all();
+    for (auto& th : _blockingThreads) {
+        th.join();
+    }
+}
+
+bool IoExecutor::Read(int fd, void* buf, size_t len, off_t offset, Completion then)
+{
+    return Submit(std::make_unique<Request>(Request {false, fd, {buf, len}, offset, std::move(then)}));
+}
+
+bool IoExecutor::Write(int fd, const void* buf, size_t len, off_t offset, Completion then)
+{
+    // iovec is shared by reads and writes, the buffer is never written by a write request
+    return Submit(
+        std::make_unique<Request>(Request {true, fd, {const_cast<void*>(buf), len}, offset, std::move(then)}));
+}
+
+bool IoExecutor::Submit(std::unique_ptr<Request> request)
+{
+    std::unique_lock<std::mutex> lock {_lock};
+    if (_stopping) {
+        return false;
+    }
+
+    // one slot of the ring is kept for the nop of stopping
+    if ((_ring == nullptr) || (_inflight + 1 >= _ring->sqEntries) || !_pending.empty()) {
+        _pending.push_back(std::move(request));
+        lock.unlock();
+        _cv.notify_one();
+        return true;
+    }
+
+    PushToRing(request.release());
+    lock.unlock();
+    Flush();
+    return true;
+}
+
+void IoExecutor::Complete(std::unique_ptr<Request> request, ssize_t result)
+{
+    Finished finished;
+    finished.emplace_back(std::move(request->then), result);
+    request.reset();
+    Complete(std::move(finished));
+}
+
+void IoExecutor::Complete(Finished finished)
+{
+    auto batch = std::make_shared<Finished>(std::move(finished));
+    auto run = [batch]() {
+        for (auto& [then, result] : *batch) {
+            then(result);
+        }
+    };
+    // a full pool must not lose the results, they are handed over on the current thread then
+    if (!_pool.AddTask(run).valid()) {
+        run();
+    }
+}
+
+bool IoExecutor::SetupRing(uint32_t queueDepth)
+{
+    io_uring_params params {};
+    auto ring = std::make_unique<Ring>();
+    ring->fd = IoUringSetup(queueDepth, &params);
+    if (ring->fd < 0) {
+        return false;
+    }
+
+    ring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    ring->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    // newer kernels map both rings at once
+    if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0) {
+        ring->sqRingSize = std::max(ring->sqRingSize, ring->cqRingSize);
+        ring->cqRingSize = ring->sqRingSize;
+    }
+
+    ring->sqRing = mmap(nullptr, ring->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+                        IORING_OFF_SQ_RING);
+    if (ring->sqRing == MAP_FAILED) {
+        return false;
+    }
+
+    if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0) {
+        ring->cqRing = ring->sqRing;
+    } else {
+        ring->cqRing = mmap(nullptr, ring->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                            ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cqRing == MAP_FAILED) {
+            return false;
+        }
+    }
+
+    ring->sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    ring->sqes = static_cast<io_uring_sqe*>(mmap(nullptr, ring->sqesSize, PROT_READ | PROT_WRITE,
+                                                 MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES));
+    if (ring->sqes == MAP_FAILED) {
+        return false;
+    }
+
+    auto sq = static_cast<uint8_t*>(ring->sqRing);
+    auto cq = static_cast<uint8_t*>(ring->cqRing);
+    ring->sqEntries = params.sq_entries;
+    ring->sqHead = reinterpret_cast<uint32_t*>(sq + params.sq_off.head);
+    ring->sqTail = reinterpret_cast<uint32_t*>(sq + params.sq_off.tail);
+    ring->sqMask = reinterpret_cast<uint32_t*>(sq + params.sq_off.ring_mask);
+    ring->sqArray = reinterpret_cast<uint32_t*>(sq + params.sq_off.array);
+    ring->cqHead = reinterpret_cast<uint32_t*>(cq + params.cq_off.head);
+    ring->cqTail = reinterpret_cast<uint32_t*>(cq + params.cq_off.tail);
+    ring->cqMask = reinterpret_cast<uint32_t*>(cq + params.cq_off.ring_mask);
+    ring->cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    _ring = std::move(ring);
+    return true;
+}
+
+void IoExecutor::PushToRing(Request* request)
+{
+    // called with _lock held, so this is the only producer of the submission queue. the kernel gets it by Flush
+    uint32_t tail = *_ring->sqTail;
+    uint32_t index = tail & *_ring->sqMask;
+    io_uring_sqe& sqe = _ring->sqes[index];
+    std::memset(&sqe, 0, sizeof(sqe));
+    if (request == nullptr) {
+        sqe.opcode = IORING_OP_NOP;
+        sqe.user_data = STOP_USER_DATA;
+    } else {
+        // the vectored ones are supported since the first version of io_uring
+        sqe.opcode = request->write ? IORING_OP_WRITEV : IORING_OP_READV;
+        sqe.fd = request->fd;
+        sqe.addr = reinterpret_cast<uint64_t>(&request->iov);
+        sqe.len = 1;
+        sqe.off = static_cast<uint64_t>(request->offset);
+        sqe.user_data = reinterpret_cast<uint64_t>(request);
+    }
+    _ring->sqArray[index] = index;
+    StoreRelease(_ring->sqTail, tail + 1);
+    _unsubmitted++;
+    if (request != nullptr) {
+        _inflight++;
+    }
+}
+
+void IoExecutor::Flush()
+{
+    // one thread hands the entries to the kernel, the others only add theirs to its next io_uring_enter
+    std::unique_lock<std::mutex> lock {_lock};
+    if (_flushing) {
+        return;
+    }
+    _flushing = true;
+
+    std::vector<std::pair<std::unique_ptr<Request>, ssize_t>> failed;
+    while (_unsubmitted != 0) {
+        uint32_t toSubmit = std::exchange(_unsubmitted, 0);
+        lock.unlock();
+        int ret = IoUringEnter(_ring->fd, toSubmit, 0, 0);
+        int err = (ret < 0) ? errno : EAGAIN;
+        lock.lock();
+        if (ret > 0) {
+            _unsubmitted += toSubmit - static_cast<uint32_t>(ret);
+            continue;
+        }
+        TakeBack(err, failed);
+        if (_unsubmitted != 0) {
+            // only the stop is left, e.g. the completion queue is full, give the completion thread time to reap
+            lock.unlock();
+            std::this_thread::yield();
+            lock.lock();
+        }
+    }
+    _flushing = false;
+    lock.unlock();
+
+    for (auto& [request, result] : failed) {
+        Complete(std::move(request), result);
+    }
+}
+
+void IoExecutor::TakeBack(int err, std::vector<std::pair<std::unique_ptr<Request>, ssize_t>>& failed)
+{
+    // called with _lock held by the flusher, so no one else enters the ring and the rest of the queue is ours
+    uint32_t head = LoadAcquire(_ring->sqHead);
+    uint32_t tail = *_ring->sqTail;
+    bool stop = false;
+    for (uint32_t pos = head; pos != tail; pos++) {
+        auto request = reinterpret_cast<Request*>(_ring->sqes[_ring->sqArray[pos & *_ring->sqMask]].user_data);
+        if (request != nullptr) {
+            _inflight--;
+            failed.emplace_back(std::unique_ptr<Request>(request), -err);
+        } else {
+            stop = true;
+        }
+    }
+    StoreRelease(_ring->sqTail, head);
+    _unsubmitted = 0;
+
+    // the stop is the only thing which wakes up the completion thread to leave, it is pushed again for a retry
+    if (stop) {
+        PushToRing(nullptr);
+    }
+}
+
+void IoExecutor::CompletionLoop()
+{
+    bool stopped = false;
+    std::vector<std::pair<Request*, ssize_t>> reaped;
+    while (true) {
+        uint32_t head = *_ring->cqHead;
+        uint32_t tail = LoadAcquire(_ring->cqTail);
+        if (head == tail) {
+            {
+                std::lock_guard<std::mutex> lock {_lock};
+                if (stopped && (_inflight == 0) && _pending.empty()) {
+                    return;
+                }
+            }
+            (void)IoUringEnter(_ring->fd, 0, 1, IORING_ENTER_GETEVENTS);
+            continue;
+        }
+
+        // take the whole batch, so the queue is given back to the kernel before any continuation runs
+        reaped.clear();
+        for (; head != tail; head++) {
+            const io_uring_cqe& cqe = _ring->cqes[head & *_ring->cqMask];
+            reaped.emplace_back(reinterpret_cast<Request*>(cqe.user_data), cqe.res);
+        }
+        StoreRelease(_ring->cqHead, tail);
+
+        uint32_t done = 0;
+        Finished finished;
+        for (auto [request, result] : reaped) {
+            if (request == nullptr) {
+                stopped = true;
+                continue;
+            }
+            done++;
+            finished.emplace_back(std::move(request->then), result);
+            delete request;
+        }
+        if (!finished.empty()) {
+            Complete(std::move(finished));
+        }
+
+        // the freed slots go to the requests waiting for them
+        {
+            std::lock_guard<std::mutex> lock {_lock};
+            _inflight -= done;
+            while (!_pending.empty() && (_inflight + 1 < _ring->sqEntries)) {
+                PushToRing(_pending.front().release());
+                _pending.pop_front();
+            }
+        }
+        Flush();
+    }
+}
+
+void IoExecutor::BlockingLoop()
+{
+    while (true) {
+        std::unique_ptr<Request> request;
+        {
+            std::unique_lock<std::mutex> lock {_lock};
+            _cv.wait(lock, [this]() { return _stopping || !_pending.empty(); });
+            if (_pending.empty()) {
+                return;
+            }
+            request = std::move(_pending.front());
+            _pending.pop_front();
+        }
+
+        auto& [base, len] = request->iov;
+        ssize_t result;
+        do {
+            result = request->write ? pwrite(request->fd, base, len, request->offset)
+                                    : pread(request->fd, base, len, request->offset);
+        } while ((result < 0) && (errno == EINTR));
+        Complete(std::move(request), (result < 0) ? -errno : result);
+    }
+}
@@ -0,0 +1,100 @@
+#ifndef SMALL_DEMOS_IO_EXECUTOR_H
+#define SMALL_DEMOS_IO_EXECUTOR_H
+
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "thread_pool.h"
+
+/**
+ * file reads and writes which do not block pool workers. requests go to an io_uring, one completion thread
+ * reaps them and hands the results to their continuations as a task of the pool, so a small pool can keep
+ * thousands of requests in flight. requests submitted at the same time share one io_uring_enter, and the
+ * continuations of requests reaped together share one task, so neither the kernel nor the pool queue is paid
+ * per request.
+ * when io_uring can not be set up (old kernel, seccomp, ...), requests are served by a group of threads doing
+ * blocking pread/pwrite instead, the continuations still run on the pool.
+ */
+class IoExecutor {
+public:
+    enum class Backend
+    {
+        AUTO,      // io_uring if available, otherwise blocking
+        BLOCKING,  // always the blocking thread group
+    };
+
+    // bytes transferred, or -errno
+    using Completion = std::function<void(ssize_t result)>;
+
+    IoExecutor(ThreadPool& pool, uint32_t queueDepth, uint32_t blockingThreads, Backend backend = Backend::AUTO);
+    ~IoExecutor();
+
+    IoExecutor(const IoExecutor&) = delete;
+    IoExecutor& operator=(const IoExecutor&) = delete;
+    IoExecutor(const IoExecutor&&) = delete;
+    IoExecutor& operator=(const IoExecutor&&) = delete;
+
+    /**
+     * buf must stay valid until then is called. then runs on the pool, after the continuations reaped before it
+     * in the same batch, or on the completion thread if the pool refuses the batch. false if the executor is
+     * stopping, then is not called in that case.
+     */
+    bool Read(int fd, void* buf, size_t len, off_t offset, Completion then);
+    bool Write(int fd, const void* buf, size_t len, off_t offset, Completion then);
+
+    bool UsesIoUring() const
+    {
+        return _ring != nullptr;
+    }
+
+private:
+    struct Ring;
+
+    struct Request {
+        bool write;
+        int fd;
+        iovec iov;
+        off_t offset;
+        Completion then;
+    };
+
+    using Finished = std::vector<std::pair<Completion, ssize_t>>;
+
+    bool Submit(std::unique_ptr<Request> request);
+    void Complete(std::unique_ptr<Request> request, ssize_t result);
+    void Complete(Finished finished);
+
+    // io_uring
+    bool SetupRing(uint32_t queueDepth);
+    void PushToRing(Request* request);
+    void Flush();
+    void TakeBack(int err, std::vector<std::pair<std::unique_ptr<Request>, ssize_t>>& failed);
+    void CompletionLoop();
+
+    // blocking fallback
+    void BlockingLoop();
+
+    ThreadPool& _pool;
+    std::unique_ptr<Ring> _ring;
+    std::mutex _lock;
+    std::condition_variable _cv;
+    bool _stopping {false};
+    // requests waiting for a free slot of the ring, or for a blocking thread
+    std::deque<std::unique_ptr<Request>> _pending;
+    uint32_t _inflight {0};
+    // entries put into the submission queue but not handed to the kernel yet, and whether a thread is doing that
+    uint32_t _unsubmitted {0};
+    bool _flushing {false};
+    std::thread _completionThread;
+    std::vector<std::thread> _blockingThreads;
+};
+
+#endif  // SMALL_DEMOS_IO_EXECUTOR_H
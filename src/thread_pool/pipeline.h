@@ -0,0 +1,302 @@
+#ifndef SMALL_DEMOS_PIPELINE_H
+#define SMALL_DEMOS_PIPELINE_H
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "bounded_channel.h"
+#include "thread_pool.h"
+
+enum class StageMode
+{
+    SERIAL_IN_ORDER,      // one item at a time, in the order the source produced them
+    SERIAL_OUT_OF_ORDER,  // one item at a time, in any order
+    PARALLEL,             // any number of items at the same time
+};
+
+/**
+ * run items through a chain of stages on the workers of a ThreadPool.
+ * every item goes through all stages before the next batch is read, so it stays hot in cache,
+ * and at most maxTokens items are alive at the same time, which bounds the memory of the whole pipeline.
+ */
+template<typename T>
+class Pipeline {
+public:
+    // fill the item and return true, or return false when input is over. an item the source or a filter throws
+    // on is dropped and logged, the rest of the items go on
+    using Source = std::function<bool(T&)>;
+    using Filter = std::function<void(T&)>;
+
+    Pipeline(ThreadPool& threadPool, uint32_t maxTokens, uint32_t helperNum) :
+        _threadPool(threadPool),
+        _maxTokens(maxTokens < 1 ? 1 : maxTokens),
+        _helperNum(helperNum)
+    {}
+    ~Pipeline() = default;
+
+    Pipeline(const Pipeline&) = delete;
+    Pipeline& operator=(const Pipeline&) = delete;
+    Pipeline(const Pipeline&&) = delete;
+    Pipeline& operator=(const Pipeline&&) = delete;
+
+    Pipeline& AddStage(StageMode mode, Filter filter);
+    // block until all items produced by source have gone through the last stage
+    void Run(Source source);
+
+private:
+    struct Token {
+        uint64_t seq {0};
+        // the item was dropped, later stages only let its seq pass until the token is given back
+        bool dropped {false};
+        T item {};
+    };
+
+    struct Stage {
+        Stage(StageMode stageMode, Filter stageFilter, size_t capacity) :
+            mode(stageMode),
+            filter(std::move(stageFilter)),
+            input(capacity)
+        {}
+
+        // clears busy on every way out of a serial stage, a throwing filter included
+        struct BusyGuard {
+            explicit BusyGuard(std::atomic_flag& flag) : busy(flag)
+            {}
+            ~BusyGuard()
+            {
+                busy.clear(std::memory_order_release);
+            }
+            BusyGuard(const BusyGuard&) = delete;
+            BusyGuard& operator=(const BusyGuard&) = delete;
+            std::atomic_flag& busy;
+        };
+
+        StageMode mode;
+        Filter filter;
+        BoundedChannel<Token> input;
+        std::atomic_flag busy = ATOMIC_FLAG_INIT;
+        // only touched by the owner of busy, so they need no more protection
+        uint64_t nextSeq {0};
+        std::map<uint64_t, Token> pending;
+    };
+
+    void RunLoop();
+    bool Step();
+    bool Produce();
+    bool RunStage(size_t index);
+    bool RunSerialInOrder(Stage& stage, size_t index);
+    void Apply(Stage& stage, size_t index, Token& token);
+    void Forward(size_t index, Token&& token);
+
+    static void Drop(Token& token)
+    {
+        token.dropped = true;
+        token.item = T {};
+    }
+
+    bool Finished() const
+    {
+        return _sourceDone.load() && (_inFlight.load() == 0);
+    }
+
+    ThreadPool& _threadPool;
+    uint32_t _maxTokens;
+    uint32_t _helperNum;
+    std::vector<std::unique_ptr<Stage>> _stages;
+
+    Source _source;
+    std::atomic_flag _sourceBusy = ATOMIC_FLAG_INIT;
+    uint64_t _nextSeq {0};
+    std::atomic<bool> _sourceDone {false};
+    std::atomic<uint32_t> _inFlight {0};
+};
+
+template<typename T>
+Pipeline<T>& Pipeline<T>::AddStage(StageMode mode, Filter filter)
+{
+    // every channel can hold all tokens, so forwarding an item to next stage never fails
+    _stages.emplace_back(std::make_unique<Stage>(mode, std::move(filter), _maxTokens));
+    return *this;
+}
+
+template<typename T>
+void Pipeline<T>::Run(Source source)
+{
+    _source = std::move(source);
+    _nextSeq = 0;
+    _inFlight.store(0);
+    _sourceDone.store(false);
+    for (auto& stage : _stages) {
+        stage->nextSeq = 0;
+        stage->pending.clear();
+    }
+
+    // helpers may be rejected or delayed by a busy pool, the caller itself keeps the pipeline moving anyway
+    std::vector<std::future<void>> helpers;
+    for (uint32_t i = 0; i < _helperNum; i++) {
+        helpers.emplace_back(_threadPool.AddTask([this]() { RunLoop(); }));
+    }
+
+    RunLoop();
+    for (auto& helper : helpers) {
+        if (helper.valid()) {
+            helper.wait();
+        }
+    }
+}
+
+template<typename T>
+void Pipeline<T>::RunLoop()
+{
+    while (!Finished()) {
+        if (!Step()) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+template<typename T>
+bool Pipeline<T>::Step()
+{
+    // drain the downstream stages first, so tokens are given back as early as possible
+    for (size_t i = _stages.size(); i > 0; i--) {
+        if (RunStage(i - 1)) {
+            return true;
+        }
+    }
+
+    return Produce();
+}
+
+template<typename T>
+bool Pipeline<T>::Produce()
+{
+    if (_sourceDone.load() || (_inFlight.load() >= _maxTokens)) {
+        return false;
+    }
+
+    if (_sourceBusy.test_and_set(std::memory_order_acquire)) {
+        return false;
+    }
+
+    bool produced = false;
+    Token token;
+    if (!_sourceDone.load() && (_inFlight.load() < _maxTokens)) {
+        // a throwing source drops the item like a throwing filter, no seq is taken for it
+        try {
+            if (_source(token.item)) {
+                token.seq = _nextSeq++;
+                _inFlight++;
+                produced = true;
+            } else {
+                _sourceDone.store(true);
+            }
+        } catch (const std::exception& e) {
+            PRINT_ERROR("source of pipeline failed: %s", e.what());
+        } catch (...) {
+            PRINT_ERROR("source of pipeline failed");
+        }
+    }
+    _sourceBusy.clear(std::memory_order_release);
+
+    if (produced) {
+        if (_stages.empty()) {
+            _inFlight--;
+        } else {
+            (void)_stages.front()->input.TryPush(std::move(token));
+        }
+    }
+    return produced;
+}
+
+template<typename T>
+bool Pipeline<T>::RunStage(size_t index)
+{
+    Stage& stage = *_stages[index];
+    Token token;
+    if (stage.mode == StageMode::PARALLEL) {
+        if (!stage.input.TryPop(token)) {
+            return false;
+        }
+
+        Apply(stage, index, token);
+        return true;
+    }
+
+    if (stage.busy.test_and_set(std::memory_order_acquire)) {
+        return false;
+    }
+
+    typename Stage::BusyGuard guard(stage.busy);
+    if (stage.mode == StageMode::SERIAL_IN_ORDER) {
+        return RunSerialInOrder(stage, index);
+    }
+    if (!stage.input.TryPop(token)) {
+        return false;
+    }
+    Apply(stage, index, token);
+    return true;
+}
+
+template<typename T>
+bool Pipeline<T>::RunSerialInOrder(Stage& stage, size_t index)
+{
+    // items may arrive out of order after a parallel stage, park them until their turn comes
+    Token token;
+    while (stage.input.TryPop(token)) {
+        stage.pending.emplace(token.seq, std::move(token));
+    }
+
+    auto it = stage.pending.begin();
+    if ((it == stage.pending.end()) || (it->first != stage.nextSeq)) {
+        return false;
+    }
+
+    token = std::move(it->second);
+    stage.pending.erase(it);
+    stage.nextSeq++;
+
+    Apply(stage, index, token);
+    return true;
+}
+
+template<typename T>
+void Pipeline<T>::Apply(Stage& stage, size_t index, Token& token)
+{
+    if (token.dropped) {
+        Forward(index, std::move(token));
+        return;
+    }
+
+    // the half processed item of a throwing filter is dropped, but the token still goes on without it, or it
+    // would never be given back and later in-order stages would wait for its seq forever
+    try {
+        stage.filter(token.item);
+    } catch (const std::exception& e) {
+        PRINT_ERROR("filter of stage %zu failed: %s", index, e.what());
+        Drop(token);
+    } catch (...) {
+        PRINT_ERROR("filter of stage %zu failed", index);
+        Drop(token);
+    }
+    Forward(index, std::move(token));
+}
+
+template<typename T>
+void Pipeline<T>::Forward(size_t index, Token&& token)
+{
+    if (index + 1 < _stages.size()) {
+        (void)_stages[index + 1]->input.TryPush(std::move(token));
+        return;
+    }
+
+    // the item has gone through the last stage, its token can be used by source again
+    _inFlight--;
+}
+
+#endif  // SMALL_DEMOS_PIPELINE_H
@@ -0,0 +1,131 @@
+#include "reactor.h"
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <algorithm>
+
+namespace {
+constexpr uint32_t FD_BITS = 32;
+
+uint64_t MakeKey(int fd, uint32_t generation)
+{
+    return (static_cast<uint64_t>(generation) << FD_BITS) | static_cast<uint32_t>(fd);
+}
+}  // namespace
+
+Reactor::Reactor(uint32_t maxEvents) :
+    _epollFd(epoll_create1(EPOLL_CLOEXEC)),
+    _eventFd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+    _events(std::max(maxEvents, 1U))
+{
+    if (!Valid()) {
+        return;
+    }
+
+    // level-triggered, every leader sees it until it is drained
+    epoll_event ev {};
+    ev.events = EPOLLIN;
+    ev.data.u64 = INTERRUPT_KEY;
+    (void)epoll_ctl(_epollFd, EPOLL_CTL_ADD, _eventFd, &ev);
+}
+
+Reactor::~Reactor()
+{
+    if (_eventFd >= 0) {
+        close(_eventFd);
+    }
+    if (_epollFd >= 0) {
+        close(_epollFd);
+    }
+}
+
+bool Reactor::Add(int fd, uint32_t events, Handler handler)
+{
+    std::lock_guard<std::mutex> lock {_lock};
+    if (_entries.count(fd) != 0) {
+        return false;
+    }
+
+    // a new generation for each registration, so events of a closed and reused fd are not taken for the new one
+    uint32_t generation = ++_nextGeneration;
+    epoll_event ev {};
+    ev.events = events | EPOLLONESHOT;
+    ev.data.u64 = MakeKey(fd, generation);
+    if (epoll_ctl(_epollFd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        return false;
+    }
+
+    _entries.emplace(fd, std::make_shared<Entry>(Entry {std::move(handler), events, generation}));
+    return true;
+}
+
+bool Reactor::Remove(int fd)
+{
+    std::lock_guard<std::mutex> lock {_lock};
+    if (_entries.erase(fd) == 0) {
+        return false;
+    }
+
+    (void)epoll_ctl(_epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    return true;
+}
+
+void Reactor::Interrupt()
+{
+    // a syscall only when the leader may be blocked, the common case is a load
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (_polling.load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+
+    uint64_t one = 1;
+    (void)write(_eventFd, &one, sizeof(one));
+}
+
+uint32_t Reactor::Wait(int timeoutMs)
+{
+    int num = epoll_wait(_epollFd, _events.data(), static_cast<int>(_events.size()), timeoutMs);
+    return (num < 0) ? 0 : static_cast<uint32_t>(num);
+}
+
+void Reactor::Dispatch(uint32_t num)
+{
+    // the batch is taken out first, so the next leader can start waiting while this one handles it
+    thread_local std::vector<epoll_event> batch;
+    batch.assign(_events.begin(), _events.begin() + num);
+    _leader.store(0);
+    if (_leaderFreeHook) {
+        _leaderFreeHook();
+    }
+
+    for (const auto& event : batch) {
+        if (event.data.u64 == INTERRUPT_KEY) {
+            uint64_t count;
+            (void)read(_eventFd, &count, sizeof(count));
+            continue;
+        }
+
+        int fd = static_cast<int>(static_cast<uint32_t>(event.data.u64));
+        auto generation = static_cast<uint32_t>(event.data.u64 >> FD_BITS);
+        std::shared_ptr<Entry> entry;
+        {
+            std::lock_guard<std::mutex> lock {_lock};
+            auto it = _entries.find(fd);
+            if ((it == _entries.end()) || (it->second->generation != generation)) {
+                continue;
+            }
+            entry = it->second;
+        }
+
+        entry->handler(event.events);
+
+        // armed again only if it was not removed in the meantime
+        std::lock_guard<std::mutex> lock {_lock};
+        auto it = _entries.find(fd);
+        if ((it != _entries.end()) && (it->second == entry)) {
+            epoll_event ev {};
+            ev.events = entry->events | EPOLLONESHOT;
+            ev.data.u64 = event.data.u64;
+            (void)epoll_ctl(_epollFd, EPOLL_CTL_MOD, fd, &ev);
+        }
+    }
+}
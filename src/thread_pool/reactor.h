@@ -0,0 +1,114 @@
+#ifndef SMALL_DEMOS_REACTOR_H
+#define SMALL_DEMOS_REACTOR_H
+
+#include <sys/epoll.h>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * epoll loop run in leader/follower style: of all threads calling Poll, one leader waits in epoll_wait for a
+ * batch of ready events, hands the leadership over, and then runs the handlers of its batch itself. so an event
+ * is handled by the thread which saw it, there is no queue or wake-up between them.
+ * every fd is armed one-shot and armed again after its handler returns, so a handler never runs twice at once.
+ * attached to a BasicThreadPool, idle workers take turns being the leader.
+ */
+class Reactor {
+public:
+    // events are EPOLLIN, EPOLLOUT, ... which are ready
+    using Handler = std::function<void(uint32_t events)>;
+
+    explicit Reactor(uint32_t maxEvents);
+    ~Reactor();
+
+    Reactor(const Reactor&) = delete;
+    Reactor& operator=(const Reactor&) = delete;
+    Reactor(const Reactor&&) = delete;
+    Reactor& operator=(const Reactor&&) = delete;
+
+    // false if epoll or its eventfd can not be created
+    bool Valid() const
+    {
+        return (_epollFd >= 0) && (_eventFd >= 0);
+    }
+
+    // false if fd is registered already or epoll_ctl fails
+    bool Add(int fd, uint32_t events, Handler handler);
+    // fd is not armed any more, but a handler already picked up by a leader may still finish or run once
+    bool Remove(int fd);
+
+    /**
+     * wait for ready events up to timeoutMs (-1 for ever) and handle them, if no other thread is the leader.
+     * stop is checked after the thread shows up as the leader, and the wait is skipped when it holds,
+     * see Interrupt. false if another thread is the leader.
+     */
+    template<typename Pred>
+    bool Poll(int timeoutMs, Pred stop);
+
+    bool Poll(int timeoutMs)
+    {
+        return Poll(timeoutMs, []() { return false; });
+    }
+
+    // wake up the leader if it is waiting in epoll_wait, e.g. when there is other work for it
+    void Interrupt();
+
+    bool IsLeaderFree() const
+    {
+        return _leader.load() == 0;
+    }
+
+    // called each time the leader hands the leadership over, to wake up a follower
+    void SetLeaderFreeHook(std::function<void()> hook)
+    {
+        _leaderFreeHook = std::move(hook);
+    }
+
+private:
+    static constexpr uint64_t INTERRUPT_KEY = UINT64_MAX;
+
+    struct Entry {
+        Handler handler;
+        uint32_t events;
+        uint32_t generation;
+    };
+
+    uint32_t Wait(int timeoutMs);
+    void Dispatch(uint32_t num);
+
+    int _epollFd {-1};
+    int _eventFd {-1};
+    std::atomic<uint32_t> _leader {0};
+    // set while the leader may be blocked in epoll_wait
+    std::atomic<uint32_t> _polling {0};
+    // written by the leader only, and copied out before the leadership is handed over
+    std::vector<epoll_event> _events;
+    std::function<void()> _leaderFreeHook;
+
+    std::mutex _lock;
+    std::unordered_map<int, std::shared_ptr<Entry>> _entries;
+    uint32_t _nextGeneration {0};
+};
+
+template<typename Pred>
+bool Reactor::Poll(int timeoutMs, Pred stop)
+{
+    uint32_t expected = 0;
+    if (!_leader.compare_exchange_strong(expected, 1)) {
+        return false;
+    }
+
+    // pairs with the caller of Interrupt, which makes stop true before it reads _polling
+    _polling.store(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    uint32_t num = stop() ? 0 : Wait(timeoutMs);
+    _polling.store(0, std::memory_order_relaxed);
+    Dispatch(num);
+    return true;
+}
+
+#endif  // SMALL_DEMOS_REACTOR_H
@@ -0,0 +1,141 @@
+#include "slab_allocator.h"
+#include <algorithm>
+#include <bit>
+#include <iterator>
+
+SlabHeap::~SlabHeap()
+{
+    // chunks are owned by caches, so every block is released here at once
+    std::lock_guard<std::mutex> lock {_registry->lock};
+    _registry->caches.clear();
+    _registry->alive = false;
+}
+
+SlabHeap::ThreadCaches::~ThreadCaches()
+{
+    // the blocks of a cache may still be in use, so it is left with its chunks for another thread to adopt
+    for (auto& [registry, cache] : owned) {
+        std::lock_guard<std::mutex> lock {registry->lock};
+        if (registry->alive) {
+            cache->thread = std::thread::id();
+        }
+    }
+    // frees after this find no cache of their own and go to the remote lists
+    _localEntry = {0, nullptr};
+}
+
+uint32_t SlabHeap::SizeClass(size_t size)
+{
+    // the smallest power of 2 which holds the header and the block, starts from MIN_BLOCK_SIZE
+    size_t blockSize = std::bit_ceil(std::max(size + HEADER_SIZE, MIN_BLOCK_SIZE));
+    return static_cast<uint32_t>(std::countr_zero(blockSize) - std::countr_zero(MIN_BLOCK_SIZE));
+}
+
+SlabHeap::Cache* SlabHeap::LocalCache(bool create)
+{
+    // a thread without a cache is remembered too, it may only free blocks, e.g. the consumer of a channel
+    auto& entry = _localEntry;
+    if ((entry.heapId == _heapId) && ((entry.cache != nullptr) || !create)) {
+        return entry.cache;
+    }
+
+    std::lock_guard<std::mutex> lock {_registry->lock};
+    auto& caches = _registry->caches;
+    auto self = std::this_thread::get_id();
+    // the thread may have switched to another heap in between, its cache is still here
+    auto it = std::find_if(caches.begin(), caches.end(), [self](const auto& cache) { return cache->thread == self; });
+    if (it != caches.end()) {
+        entry = {_heapId, it->get()};
+        return entry.cache;
+    }
+
+    if (!create) {
+        entry = {_heapId, nullptr};
+        return nullptr;
+    }
+
+    // a cache left by an exited thread comes with its free blocks and chunks, a new one is only made without it
+    it = std::find_if(caches.begin(), caches.end(),
+                      [](const auto& cache) { return cache->thread == std::thread::id(); });
+    if (it == caches.end()) {
+        caches.emplace_back(std::make_unique<Cache>());
+        it = std::prev(caches.end());
+    }
+    (*it)->thread = self;
+    static thread_local ThreadCaches threadCaches;
+    threadCaches.owned.emplace_back(_registry, it->get());
+    entry = {_heapId, it->get()};
+    return entry.cache;
+}
+
+void SlabHeap::Refill(Cache& cache, uint32_t sizeClass)
+{
+    // blocks freed by other threads are taken back as a whole batch
+    cache.localFree[sizeClass] = cache.remoteFree[sizeClass].exchange(nullptr, std::memory_order_acquire);
+    if (cache.localFree[sizeClass] != nullptr) {
+        return;
+    }
+
+    size_t blockSize = MIN_BLOCK_SIZE << sizeClass;
+    auto chunk = std::unique_ptr<std::byte[]>(new std::byte[CHUNK_SIZE]);
+    FreeBlock* head = nullptr;
+    for (size_t offset = 0; offset + blockSize <= CHUNK_SIZE; offset += blockSize) {
+        auto header = new (chunk.get() + offset) Header {&cache, sizeClass};
+        auto block = reinterpret_cast<FreeBlock*>(reinterpret_cast<std::byte*>(header) + HEADER_SIZE);
+        block->next = head;
+        head = block;
+    }
+
+    cache.chunks.push_back(std::move(chunk));
+    cache.localFree[sizeClass] = head;
+}
+
+void* SlabHeap::Allocate(size_t size, size_t align)
+{
+    if (!IsSmall(size, align)) {
+        return ::operator new(size, std::align_val_t(align));
+    }
+
+    auto cache = LocalCache(true);
+    uint32_t sizeClass = SizeClass(size);
+    if (cache->localFree[sizeClass] == nullptr) {
+        Refill(*cache, sizeClass);
+    }
+
+    FreeBlock* block = cache->localFree[sizeClass];
+    cache->localFree[sizeClass] = block->next;
+    return block;
+}
+
+void SlabHeap::Deallocate(void* ptr, size_t size, size_t align)
+{
+    if (!IsSmall(size, align)) {
+        ::operator delete(ptr, std::align_val_t(align));
+        return;
+    }
+
+    auto header = reinterpret_cast<Header*>(static_cast<std::byte*>(ptr) - HEADER_SIZE);
+    auto block = static_cast<FreeBlock*>(ptr);
+    Cache* owner = header->owner;
+    if (owner == LocalCache(false)) {
+        block->next = owner->localFree[header->sizeClass];
+        owner->localFree[header->sizeClass] = block;
+        return;
+    }
+
+    auto& remoteFree = owner->remoteFree[header->sizeClass];
+    block->next = remoteFree.load(std::memory_order_relaxed);
+    while (!remoteFree.compare_exchange_weak(block->next, block, std::memory_order_release,
+                                             std::memory_order_relaxed)) {
+    }
+}
+
+size_t SlabHeap::GetChunkNum() const
+{
+    std::lock_guard<std::mutex> lock {_registry->lock};
+    size_t num = 0;
+    for (const auto& cache : _registry->caches) {
+        num += cache->chunks.size();
+    }
+    return num;
+}
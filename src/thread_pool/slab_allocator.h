@@ -0,0 +1,176 @@
+#ifndef SMALL_DEMOS_SLAB_ALLOCATOR_H
+#define SMALL_DEMOS_SLAB_ALLOCATOR_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * slab heap for small objects which are allocated by one thread and often freed by another one,
+ * like the closure and the shared state of a pool task.
+ * every allocating thread gets its own cache of free lists, for a pool that is the submitter of a task. a block
+ * freed by its owner thread goes back to the local list without any atomic, a block freed by another thread is
+ * pushed to a lock-free list of the owner, and the owner takes the whole list back in one exchange when its local
+ * list runs out. the cache of a thread which exits is adopted by the next thread which needs one.
+ */
+class SlabHeap {
+public:
+    SlabHeap() : _heapId(_nextHeapId.fetch_add(1)), _registry(std::make_shared<Registry>())
+    {}
+    ~SlabHeap();
+
+    SlabHeap(const SlabHeap&) = delete;
+    SlabHeap& operator=(const SlabHeap&) = delete;
+    SlabHeap(const SlabHeap&&) = delete;
+    SlabHeap& operator=(const SlabHeap&&) = delete;
+
+    // blocks bigger than MAX_BLOCK_SIZE or aligned more than BLOCK_ALIGN go to the global allocator
+    void* Allocate(size_t size, size_t align);
+    // size and align must be the same as the ones given to Allocate
+    void Deallocate(void* ptr, size_t size, size_t align);
+
+    size_t GetChunkNum() const;
+
+private:
+    static constexpr size_t BLOCK_ALIGN = 16;
+    static constexpr size_t HEADER_SIZE = 16;
+    static constexpr size_t MIN_BLOCK_SIZE = 32;
+    static constexpr size_t MAX_BLOCK_SIZE = 512;
+    static constexpr size_t CLASS_NUM = 5;  // 32, 64, 128, 256, 512
+    static constexpr size_t CHUNK_SIZE = 16 * 1024;
+
+    struct Cache;
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    // put in front of each block, so whoever frees it knows where it comes from
+    struct alignas(BLOCK_ALIGN) Header {
+        Cache* owner;
+        uint32_t sizeClass;
+    };
+    static_assert(sizeof(Header) == HEADER_SIZE);
+
+    struct Cache {
+        FreeBlock* localFree[CLASS_NUM] {};
+        std::atomic<FreeBlock*> remoteFree[CLASS_NUM] {};
+        std::vector<std::unique_ptr<std::byte[]>> chunks;
+        std::thread::id thread;  // none once the thread has exited, until another one adopts the cache
+    };
+
+    // the caches of a heap, an exiting thread may still reach them after the heap is gone
+    struct Registry {
+        std::mutex lock;
+        std::vector<std::unique_ptr<Cache>> caches;
+        bool alive {true};
+    };
+
+    // the caches a thread owns, they are handed back to their heaps when it exits
+    struct ThreadCaches {
+        ~ThreadCaches();
+
+        std::vector<std::pair<std::shared_ptr<Registry>, Cache*>> owned;
+    };
+
+    // a thread usually works with one heap only, so one cached entry is enough to skip the lock
+    struct LocalEntry {
+        uint64_t heapId;
+        Cache* cache;
+    };
+
+    static bool IsSmall(size_t size, size_t align)
+    {
+        return (size + HEADER_SIZE <= MAX_BLOCK_SIZE) && (align <= BLOCK_ALIGN);
+    }
+
+    static uint32_t SizeClass(size_t size);
+    Cache* LocalCache(bool create);
+    void Refill(Cache& cache, uint32_t sizeClass);
+
+    static inline std::atomic<uint64_t> _nextHeapId {1};
+    static inline thread_local LocalEntry _localEntry {0, nullptr};
+
+    uint64_t _heapId;
+    std::shared_ptr<Registry> _registry;
+};
+
+// std allocator on a SlabHeap, it keeps the heap alive as long as any memory from it may still be in use
+template<typename T>
+class SlabAllocator {
+public:
+    using value_type = T;
+
+    explicit SlabAllocator(std::shared_ptr<SlabHeap> heap) : _heap(std::move(heap))
+    {}
+
+    template<typename U>
+    SlabAllocator(const SlabAllocator<U>& other) : _heap(other.GetHeap())  // NOLINT: rebind like std::allocator
+    {}
+
+    T* allocate(size_t n)
+    {
+        return static_cast<T*>(_heap->Allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* ptr, size_t n)
+    {
+        _heap->Deallocate(ptr, n * sizeof(T), alignof(T));
+    }
+
+    const std::shared_ptr<SlabHeap>& GetHeap() const
+    {
+        return _heap;
+    }
+
+    template<typename U>
+    bool operator==(const SlabAllocator<U>& other) const
+    {
+        return _heap == other.GetHeap();
+    }
+
+private:
+    std::shared_ptr<SlabHeap> _heap;
+};
+
+// move-only owner of a callable placed on a SlabHeap, the heap must outlive it
+template<typename Func>
+class SlabBox {
+public:
+    SlabBox(SlabHeap& heap, Func&& func) : _heap(&heap)
+    {
+        _func = new (heap.Allocate(sizeof(Func), alignof(Func))) Func(std::move(func));
+    }
+
+    ~SlabBox()
+    {
+        if (_func != nullptr) {
+            _func->~Func();
+            _heap->Deallocate(_func, sizeof(Func), alignof(Func));
+        }
+    }
+
+    SlabBox(SlabBox&& other) noexcept : _heap(other._heap), _func(std::exchange(other._func, nullptr))
+    {}
+
+    SlabBox& operator=(SlabBox&&) = delete;
+    SlabBox(const SlabBox&) = delete;
+    SlabBox& operator=(const SlabBox&) = delete;
+
+    void operator()()
+    {
+        (*_func)();
+    }
+
+private:
+    SlabHeap* _heap;
+    Func* _func;
+};
+
+#endif  // SMALL_DEMOS_SLAB_ALLOCATOR_H
@@ -0,0 +1,106 @@
+#include "task_tracer.h"
+#include <map>
+#include <vector>
+#include "utils/chrome_trace.h"
+#include "worker_local.h"
+
+TaskTracer::TaskTracer(size_t eventsPerThread) :
+    _tracerId(_nextTracerId.fetch_add(1)), _eventsPerThread(eventsPerThread), _origin(Clock::now())
+{}
+
+TaskTracer::ThreadBuffer* TaskTracer::LocalBuffer()
+{
+    // a thread usually records for one tracer only, so one cached entry is enough to skip the lock
+    struct Cache {
+        uint64_t tracerId;
+        ThreadBuffer* buffer;
+    };
+    static thread_local Cache cache {0, nullptr};
+    if (cache.tracerId == _tracerId) {
+        return cache.buffer;
+    }
+
+    std::lock_guard<std::mutex> lock {_buffersLock};
+    auto& buffer = _buffers[std::this_thread::get_id()];
+    if (buffer == nullptr) {
+        auto tid = static_cast<uint32_t>(_buffers.size());
+        auto context = WorkerContext::Current();
+        std::string name = (context == nullptr) ? ("thread " + std::to_string(tid))
+                                                : ("worker " + std::to_string(context->WorkerId()));
+        buffer = std::make_unique<ThreadBuffer>(_eventsPerThread, tid, std::move(name));
+    }
+
+    cache = {_tracerId, buffer.get()};
+    return buffer.get();
+}
+
+void TaskTracer::Record(EventType type, uint64_t taskId, const char* label)
+{
+    auto buffer = LocalBuffer();
+    auto ts = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - _origin).count();
+    buffer->ring.Push({taskId, ts, label, type, buffer->tid});
+}
+
+void TaskTracer::Dump(std::ostream& out) const
+{
+    struct TaskSpan {
+        const Event* submit {nullptr};
+        const Event* start {nullptr};
+        const Event* end {nullptr};
+    };
+
+    std::vector<Event> events;
+    std::vector<std::pair<uint32_t, std::string>> threadNames;
+    {
+        std::lock_guard<std::mutex> lock {_buffersLock};
+        for (const auto& [id, buffer] : _buffers) {
+            threadNames.emplace_back(buffer->tid, buffer->name);
+            buffer->ring.Collect(events);
+        }
+    }
+
+    std::map<uint64_t, TaskSpan> spans;
+    for (const auto& event : events) {
+        auto& span = spans[event.taskId];
+        if (event.type == EventType::SUBMIT) {
+            span.submit = &event;
+        } else if (event.type == EventType::START) {
+            span.start = &event;
+        } else {
+            span.end = &event;
+        }
+    }
+
+    ChromeTraceWriter trace(out);
+    for (const auto& [tid, name] : threadNames) {
+        trace.ThreadName(tid, name);
+    }
+
+    using Writer = ChromeTraceWriter;
+    for (const auto& [taskId, span] : spans) {
+        if ((span.start != nullptr) && (span.end != nullptr)) {
+            auto& event = trace.Next();
+            event << "{\"name\":\"" << Writer::Escape(span.start->label, "task") << "\",\"cat\":\"task\",\"ph\":\"X\""
+                  << ",\"pid\":1,\"tid\":" << span.start->tid << ",\"ts\":" << Writer::ToUs(span.start->ts)
+                  << ",\"dur\":" << Writer::ToUs(span.end->ts - span.start->ts) << ",\"args\":{\"id\":" << taskId;
+            if (span.submit != nullptr) {
+                event << ",\"queued_us\":" << Writer::ToUs(span.start->ts - span.submit->ts);
+            }
+            event << "}}";
+        }
+
+        if (span.submit == nullptr) {
+            continue;
+        }
+
+        // arrow from the submitter to the worker
+        trace.Next() << "{\"name\":\"submit\",\"cat\":\"task\",\"ph\":\"s\",\"id\":" << taskId
+                     << ",\"pid\":1,\"tid\":" << span.submit->tid << ",\"ts\":" << Writer::ToUs(span.submit->ts) << "}";
+        if (span.start != nullptr) {
+            trace.Next() << "{\"name\":\"submit\",\"cat\":\"task\",\"ph\":\"f\",\"bp\":\"e\",\"id\":" << taskId
+                         << ",\"pid\":1,\"tid\":" << span.start->tid << ",\"ts\":" << Writer::ToUs(span.start->ts)
+                         << "}";
+        }
+    }
+    trace.Finish();
+}
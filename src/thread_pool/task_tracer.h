@@ -0,0 +1,108 @@
+#ifndef SMALL_DEMOS_TASK_TRACER_H
+#define SMALL_DEMOS_TASK_TRACER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include "utils/trace_ring.h"
+
+/**
+ * records submit/start/end of each task into a TraceRing owned by the recording thread, and dumps them as
+ * Chrome trace-event json which can be opened by chrome://tracing or Perfetto.
+ * recording takes no lock and never allocates after the first event of a thread, and the ring buffers only
+ * keep the latest events, so it can be left on all the time.
+ */
+class TaskTracer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class EventType : uint32_t
+    {
+        SUBMIT,
+        START,
+        END,
+    };
+
+    // label of the tasks submitted by the current thread while it is alive
+    class ScopedLabel {
+    public:
+        explicit ScopedLabel(const char* label) : _prev(_label)
+        {
+            _label = label;
+        }
+        ~ScopedLabel()
+        {
+            _label = _prev;
+        }
+
+        ScopedLabel(const ScopedLabel&) = delete;
+        ScopedLabel& operator=(const ScopedLabel&) = delete;
+
+    private:
+        const char* _prev;
+    };
+
+    explicit TaskTracer(size_t eventsPerThread);
+    ~TaskTracer() = default;
+
+    TaskTracer(const TaskTracer&) = delete;
+    TaskTracer& operator=(const TaskTracer&) = delete;
+    TaskTracer(const TaskTracer&&) = delete;
+    TaskTracer& operator=(const TaskTracer&&) = delete;
+
+    uint64_t NextTaskId()
+    {
+        return _nextTaskId.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // label should be a string literal or live as long as the tracer
+    void Record(EventType type, uint64_t taskId, const char* label);
+    void Dump(std::ostream& out) const;
+
+    // label set by ScopedLabel of the current thread, nullptr if there is none
+    static const char* CurrentLabel()
+    {
+        return _label;
+    }
+
+private:
+    struct Event {
+        uint64_t taskId;
+        int64_t ts;
+        const char* label;
+        EventType type;
+        uint32_t tid;
+    };
+
+    // written by its owner thread only, read by Dump
+    struct ThreadBuffer {
+        ThreadBuffer(size_t capacity, uint32_t threadId, std::string threadName) :
+            ring(capacity), tid(threadId), name(std::move(threadName))
+        {}
+
+        TraceRing<Event> ring;
+        uint32_t tid;
+        std::string name;
+    };
+
+    ThreadBuffer* LocalBuffer();
+
+    static inline thread_local const char* _label {nullptr};
+    static inline std::atomic<uint64_t> _nextTracerId {1};
+
+    uint64_t _tracerId;
+    size_t _eventsPerThread;
+    Clock::time_point _origin;
+    std::atomic<uint64_t> _nextTaskId {1};
+
+    mutable std::mutex _buffersLock;
+    std::unordered_map<std::thread::id, std::unique_ptr<ThreadBuffer>> _buffers;
+};
+
+#endif  // SMALL_DEMOS_TASK_TRACER_H
@@ -3,6 +3,7 @@
 
 #include <future>
 #include <memory>
+#include <source_location>
 #include <vector>
 #include "thread_pool.h"
 
@@ -18,8 +19,10 @@ public:
         _threadPool->Destroy();
     }
 
+    // site is where ParallelInvoke is called, it shows in watchdog reports of the tasks
     template<typename Container, typename Func>
-    auto ParallelInvoke(const Container& funcArgs, Func func)
+    auto ParallelInvoke(const Container& funcArgs, Func func,
+                        const std::source_location& site = std::source_location::current())
         -> std::vector<decltype(func(std::declval<typename Container::value_type>()))>;
 
 private:
@@ -27,7 +30,7 @@ private:
 };
 
 template<typename Container, typename Func>
-auto ThreadManager::ParallelInvoke(const Container& funcArgs, Func func)
+auto ThreadManager::ParallelInvoke(const Container& funcArgs, Func func, const std::source_location& site)
     -> std::vector<decltype(func(std::declval<typename Container::value_type>()))>
 {
     using ResType = decltype(func(std::declval<typename Container::value_type>()));
@@ -35,7 +38,7 @@ auto ThreadManager::ParallelInvoke(const Container& funcArgs, Func func)
     std::vector<ResType> result;
     std::vector<std::future<ResType>> futures;
     for (const auto& arg : funcArgs) {
-        futures.emplace_back(_threadPool->AddTask(func, arg));
+        futures.emplace_back(_threadPool->AddTaskAt(site, func, arg));
     }
 
     std::for_each(futures.begin(), futures.end(), [&result](auto& f) {
@@ -1,85 +1,357 @@
 #ifndef SMALL_DEMOS_THREAD_POOL_H
 #define SMALL_DEMOS_THREAD_POOL_H
 
-#include <condition_variable>
 #include <functional>
 #include <future>
-#include <iostream>
-#include <mutex>
-#include <queue>
+#include <source_location>
+#include <string>
 #include <thread>
 #include <vector>
+#include "thread_pool_features.h"
+#include "thread_pool_policy.h"
+#include "utils/utils.h"
 
-class ThreadPool {
+// same as pool.AddTask(...), but the call site is kept for the reports of watchdog
+#define THREAD_POOL_ADD_TASK(pool, ...) (pool).AddTaskAt(std::source_location::current(), __VA_ARGS__)
+
+/**
+ * thread pool assembled from policies at compile time, see thread_pool_policy.h for what each policy provides.
+ * ThreadPool keeps the original combination, the other aliases below are the lean and the instrumented ones.
+ * the optional features, a reactor, hibernation, worker-local storage, the watchdog and tracing, come with
+ * IdleWait and PoolHooks of thread_pool_features.h, a pool without them has none of their cost.
+ */
+template<template<typename> class QueuePolicy, typename WaitPolicy, typename TaskPolicy, typename StatsPolicy,
+         typename AdmissionPolicy, typename HooksPolicy = NoHooks>
+class BasicThreadPool {
 public:
-    using Task = std::function<void()>;
+    using Task = typename TaskPolicy::Type;
+    using Clock = std::chrono::steady_clock;
 
-    ThreadPool(uint32_t poolSize, uint32_t waitQueueSize)
+    BasicThreadPool(uint32_t poolSize, uint32_t waitQueueSize) :
+        _queue(ClampSize(waitQueueSize, MAX_WAIT_QUEUE_SIZE), ClampSize(poolSize, MAX_POOL_SIZE))
     {
-        constexpr uint32_t MIN_SIZE = 1;
-        constexpr uint32_t MAX_WAIT_QUEUE_SIZE = 10;
-        constexpr uint32_t MAX_POOL_SIZE = 10;
-
-        _waitQueFreeSize = (waitQueueSize < MIN_SIZE)
-                               ? MIN_SIZE
-                               : ((waitQueueSize > MAX_WAIT_QUEUE_SIZE) ? MAX_WAIT_QUEUE_SIZE : waitQueueSize);
-        uint32_t realPoolSize = (poolSize < MIN_SIZE) ? MIN_SIZE
-                                                      : ((poolSize > MAX_POOL_SIZE) ? MAX_POOL_SIZE : poolSize);
-        _threads.reserve(realPoolSize);
+        if ((poolSize > MAX_POOL_SIZE) || (waitQueueSize > MAX_WAIT_QUEUE_SIZE)) {
+            PRINT_INFO("ThreadPool(%u, %u) is clamped to (%u, %u)!", poolSize, waitQueueSize,
+                       ClampSize(poolSize, MAX_POOL_SIZE), ClampSize(waitQueueSize, MAX_WAIT_QUEUE_SIZE));
+        }
+        _threads.reserve(ClampSize(poolSize, MAX_POOL_SIZE));
     }
-    ~ThreadPool() = default;
+    ~BasicThreadPool() = default;
 
-    ThreadPool(const ThreadPool&) = delete;
-    ThreadPool& operator=(const ThreadPool&) = delete;
-    ThreadPool(const ThreadPool&&) = delete;
-    ThreadPool& operator=(const ThreadPool&&) = delete;
+    BasicThreadPool(const BasicThreadPool&) = delete;
+    BasicThreadPool& operator=(const BasicThreadPool&) = delete;
+    BasicThreadPool(const BasicThreadPool&&) = delete;
+    BasicThreadPool& operator=(const BasicThreadPool&&) = delete;
 
     void Init();
     void Destroy();
 
+    /**
+     * shed new tasks early when they have been waiting in queue longer than target for a whole interval,
+     * so callers fail fast instead of all missing their deadlines. it should be called before Init.
+     */
+    void EnableAdmissionControl(Clock::duration target, Clock::duration interval) requires
+        requires(AdmissionPolicy& admission) { admission.Enable(target, interval); }
+    {
+        _admission.Enable(target, interval);
+    }
+
+    double GetShedRate() const requires requires(const AdmissionPolicy& admission) { admission.GetShedRate(); }
+    {
+        return _admission.GetShedRate();
+    }
+
+    /**
+     * give every worker a ScratchArena which is reset after each task, tasks reach it by
+     * CurrentWorker()->Arena(). it should be called before Init.
+     */
+    void EnableScratchArena(size_t chunkSize) requires requires(HooksPolicy& hooks) {
+        hooks.EnableScratchArena(chunkSize);
+    }
+    {
+        _hooks.EnableScratchArena(chunkSize);
+    }
+
+    /**
+     * report tasks running longer than threshold together with the place they were submitted from, by onStall
+     * or by printing when it is empty. if compensate is set, a temporary worker is started for each stalled one
+     * and goes away after the stalled task finishes. it should be called before Init.
+     */
+    void EnableWatchdog(Clock::duration threshold, bool compensate, Watchdog::StallHandler onStall = nullptr) requires
+        requires(HooksPolicy& hooks) { hooks.EnableWatchdog(threshold, compensate, std::move(onStall)); }
+    {
+        _hooks.EnableWatchdog(threshold, compensate, std::move(onStall));
+    }
+
+    /**
+     * record submit/start/end of every task into per-thread ring buffers keeping the latest eventsPerThread
+     * events, see TaskTracer. tasks are labeled by TaskTracer::ScopedLabel of the submitter, or by the function
+     * they were submitted from. it should be called before Init.
+     */
+    void EnableTracing(size_t eventsPerThread) requires requires(HooksPolicy& hooks) {
+        hooks.EnableTracing(eventsPerThread);
+    }
+    {
+        _hooks.EnableTracing(eventsPerThread);
+    }
+
+    /**
+     * workers beyond the first minWorkers ones exit after they have found nothing to do for idleTime, so an idle
+     * pool does not keep threads and stacks it does not need. the first task submitted after that starts all of
+     * them again at once, before the burst piles up in queue. a restarted worker gets back its WorkerContext, so
+     * its locals and arena are still warm. it should be called before Init.
+     */
+    void EnableHibernation(Clock::duration idleTime, uint32_t minWorkers) requires requires(WaitPolicy& wait) {
+        wait.EnableHibernation(idleTime, minWorkers, minWorkers);
+    }
+    {
+        _wait.EnableHibernation(idleTime, ClampSize(minWorkers, MAX_POOL_SIZE), GetPoolSize());
+    }
+
+    /**
+     * idle workers take turns running the reactor as its leader, so ready events are handled by workers
+     * directly instead of being turned into tasks. the reactor must outlive the pool, and it should not be
+     * polled by other threads. it should be called before Init.
+     */
+    void AttachReactor(Reactor& reactor) requires requires(WaitPolicy& wait) { wait.AttachReactor(reactor); }
+    {
+        _wait.AttachReactor(reactor);
+    }
+
+    // workers which are not hibernating
+    uint32_t GetActiveWorkerNum() const requires requires(const WaitPolicy& wait) { wait.GetParkedNum(); }
+    {
+        return GetPoolSize() - _wait.GetParkedNum();
+    }
+
+    // write recorded events as Chrome trace-event json, false if tracing is off or file can not be written
+    bool DumpTrace(const std::string& file) const requires requires(const HooksPolicy& hooks) {
+        hooks.DumpTrace(file);
+    }
+    {
+        return _hooks.DumpTrace(file);
+    }
+
+    // storage of the worker running the calling task, nullptr if the caller is not a worker
+    static auto* CurrentWorker() requires requires { HooksPolicy::CurrentWorker(); }
+    {
+        return HooksPolicy::CurrentWorker();
+    }
+
+    // number of workers after the size given to constructor is clamped
+    uint32_t GetPoolSize() const
+    {
+        return static_cast<uint32_t>(_threads.capacity());
+    }
+
+    auto GetStats() const requires requires(const StatsPolicy& stats) { stats.Get(); }
+    {
+        return _stats.Get();
+    }
+
+    // workers in their loop, not hibernating
+    int64_t GetRunningWorkerNum() const requires requires(const StatsPolicy& stats) { stats.GetRunningWorkers(); }
+    {
+        return _stats.GetRunningWorkers();
+    }
+
+    template<typename F, typename... Args>
+    auto AddTask(F&& f, Args&&... args) -> std::future<decltype(f(args...))>
+    {
+        return AddTaskAt(std::source_location {}, std::forward<F>(f), std::forward<Args>(args)...);
+    }
+
     template<typename F, typename... Args>
-    auto AddTask(F&& f, Args&&... args) -> std::future<decltype(f(args...))>;
+    auto AddTaskAt(const std::source_location& site, F&& f, Args&&... args) -> std::future<decltype(f(args...))>
+    {
+        return _stats.Submit([&]() { return Enqueue(site, std::forward<F>(f), std::forward<Args>(args)...); });
+    }
 
 private:
+    static constexpr uint32_t MIN_SIZE = 1;
+    // big enough for a pool per core on large machines and for a queue which absorbs a burst of small tasks
+    static constexpr uint32_t MAX_WAIT_QUEUE_SIZE = 65536;
+    static constexpr uint32_t MAX_POOL_SIZE = 256;
+
     enum class PoolStat
     {
         RUNNING,
         STOP,
     };
+
+    struct QueuedTask {
+        Task func;
+        [[no_unique_address]] typename HooksPolicy::Tag tag;
+        [[no_unique_address]] typename AdmissionPolicy::Stamp stamp;
+    };
+
+    static uint32_t ClampSize(uint32_t size, uint32_t maxSize)
+    {
+        return (size < MIN_SIZE) ? MIN_SIZE : ((size > maxSize) ? maxSize : size);
+    }
+
+    template<typename F, typename... Args>
+    auto Enqueue(const std::source_location& site, F&& f, Args&&... args) -> std::future<decltype(f(args...))>;
+    void WorkerLoop(uint32_t workerId, bool compensator);
+    void Restart(uint32_t workerId);
+
+    // at most once a second, a log for every refused task would slow down an overloaded pool even more
+    void LogQueueFull()
+    {
+        auto now = static_cast<uint32_t>(
+            std::chrono::duration_cast<std::chrono::seconds>(Clock::now().time_since_epoch()).count());
+        uint32_t last = _lastFullLog.load(std::memory_order_relaxed);
+        if ((now != last) && _lastFullLog.compare_exchange_strong(last, now, std::memory_order_relaxed)) {
+            PRINT_ERROR("TaskQueue is full, can not add any more!");
+        }
+    }
+
     // avoid to use std::atomic<bool> or std::atomic<uint64_t>, because they are not supportted well in ARM
     std::atomic<PoolStat> _poolStat {PoolStat::RUNNING};
-    std::queue<Task> _waitQue;
-    std::atomic<uint32_t> _waitQueFreeSize {1};
-    std::mutex _waitQueLock;
+    std::atomic<uint32_t> _lastFullLog {0};  // second of the clock when a full queue was last logged
+    // tasks may live in memory of the task policy, so it goes before the queue and is destroyed after it
+    [[no_unique_address]] TaskPolicy _taskPolicy;
+    QueuePolicy<QueuedTask> _queue;
+    WaitPolicy _wait;
     std::vector<std::thread> _threads;
-    std::condition_variable _threadCV;
+    [[no_unique_address]] StatsPolicy _stats;
+    [[no_unique_address]] AdmissionPolicy _admission;
+    [[no_unique_address]] HooksPolicy _hooks;
 };
 
+using ThreadPool = BasicThreadPool<LockedQueue, IdleWait, SlabTask, MetricsStats, CoDelAdmission, PoolHooks>;
+using LeanThreadPool = BasicThreadPool<LockedQueue, BlockingWait, MoveOnlyTask, NoStats, NoAdmission>;
+using InstrumentedThreadPool =
+    BasicThreadPool<PerWorkerQueue, IdleWait, SlabTask, AtomicStats, CoDelAdmission, PoolHooks>;
+
+// the default pool is compiled once in thread_pool.cpp
+extern template class BasicThreadPool<LockedQueue, IdleWait, SlabTask, MetricsStats, CoDelAdmission, PoolHooks>;
+
+template<template<typename> class QueuePolicy, typename WaitPolicy, typename TaskPolicy, typename StatsPolicy,
+         typename AdmissionPolicy, typename HooksPolicy>
+void BasicThreadPool<QueuePolicy, WaitPolicy, TaskPolicy, StatsPolicy, AdmissionPolicy, HooksPolicy>::Init()
+{
+    // hooks are ready before the first worker runs into them
+    _hooks.Init(
+        GetPoolSize(), [this](uint32_t workerId) { WorkerLoop(workerId, true); }, [this]() { _wait.NotifyAll(); });
+
+    // fill _threads with wait loop function
+    for (uint32_t i = 0; i < _threads.capacity(); i++) {
+        _threads.emplace_back(&BasicThreadPool::WorkerLoop, this, i, false);
+    }
+}
+
+template<template<typename> class QueuePolicy, typename WaitPolicy, typename TaskPolicy, typename StatsPolicy,
+         typename AdmissionPolicy, typename HooksPolicy>
+void BasicThreadPool<QueuePolicy, WaitPolicy, TaskPolicy, StatsPolicy, AdmissionPolicy, HooksPolicy>::Destroy()
+{
+    PRINT_INFO("ThreadPool is going to stop!");
+    _hooks.Stop();
+    _poolStat.store(PoolStat::STOP);
+    _wait.NotifyAll();
+
+    for (auto& th : _threads) {
+        if (th.joinable()) {
+            th.join();
+        }
+    }
+    _hooks.Join();
+
+    // tasks left in the queue are dropped while the pool is still there, for what their destructors may call
+    for (QueuedTask task; _queue.TryPop(task, 0);) {
+        task = QueuedTask {};
+    }
+}
+
+template<template<typename> class QueuePolicy, typename WaitPolicy, typename TaskPolicy, typename StatsPolicy,
+         typename AdmissionPolicy, typename HooksPolicy>
+void BasicThreadPool<QueuePolicy, WaitPolicy, TaskPolicy, StatsPolicy, AdmissionPolicy, HooksPolicy>::WorkerLoop(
+    uint32_t workerId, bool compensator)
+{
+    auto serving = [this, workerId, compensator]() {
+        return (_poolStat == PoolStat::RUNNING) && _hooks.Serves(workerId, compensator);
+    };
+    // a compensator stands in for a worker which is still there, so it never hibernates
+    auto canPark = [this, compensator]() {
+        return !compensator && (_poolStat == PoolStat::RUNNING) && _queue.Empty();
+    };
+    _hooks.OnWorkerStart(workerId, compensator);
+    _stats.OnWorkerStart();
+
+    // a worker is in the loop of waiting notification
+    while (serving()) {
+        QueuedTask task;
+        if (!_queue.TryPop(task, workerId)) {
+            /**
+             * wait policy will not block or be waked up under:
+             * 1. task queue is not empty
+             * 2. thread pool is going to stop, or the compensator is not needed any more
+             */
+            auto ready = [this, &serving]() { return !_queue.Empty() || !serving(); };
+            if (!_wait.Idle(workerId, ready, canPark)) {
+                break;
+            }
+            continue;
+        }
+
+        _admission.OnDequeue(task.stamp);
+        _hooks.OnTaskStart(workerId, compensator, task.tag);
+        _stats.Run(task.func);
+        _hooks.OnTaskEnd(workerId, compensator, task.tag);
+    }
+
+    _stats.OnWorkerExit();
+    _hooks.OnWorkerExit();
+}
+
+template<template<typename> class QueuePolicy, typename WaitPolicy, typename TaskPolicy, typename StatsPolicy,
+         typename AdmissionPolicy, typename HooksPolicy>
+void BasicThreadPool<QueuePolicy, WaitPolicy, TaskPolicy, StatsPolicy, AdmissionPolicy, HooksPolicy>::Restart(
+    uint32_t workerId)
+{
+    // a parked worker has left its loop, joining only waits for the thread to finish exiting
+    if (_threads[workerId].joinable()) {
+        _threads[workerId].join();
+    }
+    _threads[workerId] = std::thread(&BasicThreadPool::WorkerLoop, this, workerId, false);
+}
+
+template<template<typename> class QueuePolicy, typename WaitPolicy, typename TaskPolicy, typename StatsPolicy,
+         typename AdmissionPolicy, typename HooksPolicy>
 template<typename F, typename... Args>
-auto ThreadPool::AddTask(F&& f, Args&&... args) -> std::future<decltype(f(args...))>
+auto BasicThreadPool<QueuePolicy, WaitPolicy, TaskPolicy, StatsPolicy, AdmissionPolicy, HooksPolicy>::Enqueue(
+    const std::source_location& site, F&& f, Args&&... args) -> std::future<decltype(f(args...))>
 {
     using FuncType = decltype(f(args...));
 
     if (_poolStat == PoolStat::STOP) {
-        std::cout << "ThreadPool is not running!" << std::endl;
+        PRINT_ERROR("ThreadPool is not running!");
         return std::future<FuncType>();
     }
 
-    std::lock_guard<std::mutex> lock {_waitQueLock};
-    if (_waitQueFreeSize == 0) {
-        std::cout << "TaskQueue is full, can not add any more!" << std::endl;
+    QueuedTask queuedTask;
+    _hooks.OnSubmit(queuedTask.tag, site);
+    // shed tasks are not reported one by one, it would slow down an overloaded pool even more
+    if (!_admission.Admit(queuedTask.stamp)) {
+        _stats.OnReject();
         return std::future<FuncType>();
     }
 
-    auto task =
-        std::make_shared<std::packaged_task<FuncType()>>(std::bind(std::forward<F>(f), std::forward<Args>(args)...));
-    std::future<FuncType> result = task->get_future();
-    {
-        _waitQue.emplace([task]() { (*task)(); });
-        _waitQueFreeSize--;
-        _threadCV.notify_one();
+    std::future<FuncType> result;
+    queuedTask.func = _taskPolicy.Make(std::bind(std::forward<F>(f), std::forward<Args>(args)...), result);
+    auto tag = queuedTask.tag;
+    if (!_queue.TryPush(std::move(queuedTask))) {
+        _stats.OnReject();
+        LogQueueFull();
+        return std::future<FuncType>();
     }
 
+    _hooks.OnQueued(tag);
+    _stats.OnSubmit();
+    // pushed before the wait policy looks for hibernated workers, see IdleWait
+    _wait.Resume([this]() { return _poolStat == PoolStat::RUNNING; },
+                 [this](uint32_t workerId) { Restart(workerId); });
+    _wait.NotifyOne();
     return result;
 }
 
@@ -0,0 +1,73 @@
+#include "thread_pool_features.h"
+#include <fstream>
+#include "utils/utils.h"
+
+bool PoolHooks::DumpTrace(const std::string& file) const
+{
+    if (_tracer == nullptr) {
+        return false;
+    }
+
+    std::ofstream out(file);
+    if (!out) {
+        return false;
+    }
+
+    _tracer->Dump(out);
+    return static_cast<bool>(out);
+}
+
+void PoolHooks::Stop()
+{
+    if (_watchdog != nullptr) {
+        _watchdog->Stop();
+    }
+}
+
+void PoolHooks::Join()
+{
+    std::lock_guard<std::mutex> lock {_compensatorLock};
+    for (auto& compensator : _compensators) {
+        if (compensator.thread.joinable()) {
+            compensator.thread.join();
+        }
+    }
+    _compensators.clear();
+}
+
+void PoolHooks::OnStall(const Watchdog::Report& report)
+{
+    if (_stallHandler) {
+        _stallHandler(report);
+    } else {
+        PRINT_ERROR("task from %s:%u has been running on worker(%u) for %lldms",
+                    (report.line == 0) ? "unknown" : report.file, report.line, report.workerId,
+                    static_cast<long long>(
+                        std::chrono::duration_cast<std::chrono::milliseconds>(report.elapsed).count()));
+    }
+
+    if (!_compensate) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock {_compensatorLock};
+    // release the compensators which have finished their job
+    _compensators.remove_if([](Compensator& compensator) {
+        if (compensator.done.load() == 0) {
+            return false;
+        }
+
+        compensator.thread.join();
+        return true;
+    });
+
+    auto& compensator = _compensators.emplace_back(report.workerId);
+    if (_arenaChunkSize > 0) {
+        compensator.context.EnableArena(_arenaChunkSize);
+    }
+    compensator.thread = std::thread([this, &compensator, workerId = report.workerId]() {
+        WorkerContext::Bind(&compensator.context);
+        _runWorker(workerId);
+        compensator.done.store(1);
+    });
+}
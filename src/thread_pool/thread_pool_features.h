@@ -0,0 +1,303 @@
+#ifndef SMALL_DEMOS_THREAD_POOL_FEATURES_H
+#define SMALL_DEMOS_THREAD_POOL_FEATURES_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <source_location>
+#include <string>
+#include <thread>
+#include <vector>
+#include "reactor.h"
+#include "task_tracer.h"
+#include "thread_pool_policy.h"
+#include "watchdog.h"
+#include "worker_local.h"
+
+/**
+ * policies for the optional features of a BasicThreadPool. a pool which is not assembled from them has none of
+ * their members or branches, a pool which is has every feature off until it is enabled before Init.
+ */
+
+// ---------------------------------------- wait policy ----------------------------------------
+
+/**
+ * idle workers sleep like BlockingWait, and can also take turns leading a Reactor, or hibernate. a worker which
+ * has hibernated has left its loop, the pool starts it again by Resume.
+ */
+class IdleWait {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // ready events are handled by idle workers directly instead of being turned into tasks
+    void AttachReactor(Reactor& reactor)
+    {
+        _reactor = &reactor;
+        _reactor->SetLeaderFreeHook([this]() { _blocking.NotifyOne(); });
+    }
+
+    // workers from minWorkers on leave their loop after they have found nothing to do for idleTime
+    void EnableHibernation(Clock::duration idleTime, uint32_t minWorkers, uint32_t workerNum)
+    {
+        _idleTime = idleTime;
+        _minWorkers = minWorkers;
+        _parked.assign(workerNum, 0);
+    }
+
+    uint32_t GetParkedNum() const
+    {
+        return _parkedNum.load();
+    }
+
+    template<typename Pred, typename Park>
+    bool Idle(uint32_t workerId, Pred ready, Park canPark)
+    {
+        // the leader is woken up from epoll by a new task, a follower by the leader handing over
+        if ((_reactor != nullptr) && _reactor->Poll(-1, ready)) {
+            return true;
+        }
+        auto readyOrLead = [this, &ready]() {
+            return ready() || ((_reactor != nullptr) && _reactor->IsLeaderFree());
+        };
+        if ((_idleTime == Clock::duration::zero()) || (workerId < _minWorkers)) {
+            _blocking.Wait(readyOrLead);
+            return true;
+        }
+        return _blocking.WaitFor(readyOrLead, _idleTime) || !TryPark(workerId, canPark);
+    }
+
+    template<typename Pred, typename Restart>
+    void Resume(Pred running, Restart restart)
+    {
+        // the first task of a burst brings back all hibernating workers, the later ones only pay this load
+        if (_parkedNum.load() == 0) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock {_hibernateLock};
+        if (!running()) {
+            return;
+        }
+
+        for (uint32_t i = 0; i < _parked.size(); i++) {
+            if (_parked[i] != 0) {
+                restart(i);
+                _parked[i] = 0;
+                _parkedNum.fetch_sub(1);
+            }
+        }
+    }
+
+    void NotifyOne()
+    {
+        _blocking.NotifyOne();
+        if (_reactor != nullptr) {
+            _reactor->Interrupt();
+        }
+    }
+
+    void NotifyAll()
+    {
+        _blocking.NotifyAll();
+        if (_reactor != nullptr) {
+            _reactor->Interrupt();
+        }
+        // wait for a Resume in progress, so once the pool has stopped no one restarts workers after this
+        std::lock_guard<std::mutex> lock {_hibernateLock};
+    }
+
+private:
+    template<typename Park>
+    bool TryPark(uint32_t workerId, Park canPark)
+    {
+        std::lock_guard<std::mutex> lock {_hibernateLock};
+        // pairs with the submitter which pushes before it reads _parkedNum: either the task is seen by canPark,
+        // or the submitter sees this worker parked and starts it again
+        _parkedNum.fetch_add(1);
+        if (!canPark()) {
+            _parkedNum.fetch_sub(1);
+            return false;
+        }
+
+        _parked[workerId] = 1;
+        return true;
+    }
+
+    BlockingWait _blocking;
+    Reactor* _reactor {nullptr};
+    Clock::duration _idleTime {Clock::duration::zero()};
+    uint32_t _minWorkers {0};
+    std::mutex _hibernateLock;
+    std::vector<uint32_t> _parked;
+    std::atomic<uint32_t> _parkedNum {0};
+};
+
+// ---------------------------------------- hooks policy ----------------------------------------
+
+/**
+ * worker-local storage with scratch arenas, the watchdog of stalled workers and the tracer of task spans,
+ * see the Enable functions of BasicThreadPool which forward to here.
+ */
+class PoolHooks {
+public:
+    using Clock = std::chrono::steady_clock;
+    // runs the loop of a worker on the calling thread, for a compensator
+    using WorkerRunner = std::function<void(uint32_t workerId)>;
+
+    struct Tag {
+        std::source_location site;
+        uint64_t traceId {0};
+        const char* label {nullptr};
+    };
+
+    PoolHooks() = default;
+    ~PoolHooks() = default;
+
+    PoolHooks(const PoolHooks&) = delete;
+    PoolHooks& operator=(const PoolHooks&) = delete;
+    PoolHooks(const PoolHooks&&) = delete;
+    PoolHooks& operator=(const PoolHooks&&) = delete;
+
+    void EnableScratchArena(size_t chunkSize)
+    {
+        _arenaChunkSize = chunkSize;
+    }
+
+    void EnableWatchdog(Clock::duration threshold, bool compensate, Watchdog::StallHandler onStall)
+    {
+        _stallThreshold = threshold;
+        _compensate = compensate;
+        _stallHandler = std::move(onStall);
+    }
+
+    void EnableTracing(size_t eventsPerThread)
+    {
+        _tracer = std::make_unique<TaskTracer>(eventsPerThread);
+    }
+
+    bool DumpTrace(const std::string& file) const;
+
+    static WorkerContext* CurrentWorker()
+    {
+        return WorkerContext::Current();
+    }
+
+    template<typename Runner, typename Wake>
+    void Init(uint32_t workerNum, Runner&& runWorker, Wake&& wakeAll)
+    {
+        for (uint32_t i = 0; i < workerNum; i++) {
+            _contexts.emplace_back(std::make_unique<WorkerContext>(i));
+            if (_arenaChunkSize > 0) {
+                _contexts.back()->EnableArena(_arenaChunkSize);
+            }
+        }
+        if (_stallThreshold > Clock::duration::zero()) {
+            StartWatchdog(workerNum, std::forward<Runner>(runWorker), std::forward<Wake>(wakeAll));
+        }
+    }
+
+    // no more compensators can be started after this
+    void Stop();
+    // after the workers are joined
+    void Join();
+
+    void OnSubmit(Tag& tag, const std::source_location& site)
+    {
+        tag.site = site;
+        if (_tracer != nullptr) {
+            auto label = TaskTracer::CurrentLabel();
+            tag.label = ((label == nullptr) && (site.line() != 0)) ? site.function_name() : label;
+            tag.traceId = _tracer->NextTaskId();
+        }
+    }
+
+    // only tasks which got into the queue are traced, a worker may have started it already though
+    void OnQueued(const Tag& tag)
+    {
+        if (_tracer != nullptr) {
+            _tracer->Record(TaskTracer::EventType::SUBMIT, tag.traceId, tag.label);
+        }
+    }
+
+    // a compensator is bound to its own context by the thread which runs it
+    void OnWorkerStart(uint32_t workerId, bool compensator)
+    {
+        if (!compensator) {
+            WorkerContext::Bind(_contexts[workerId].get());
+        }
+    }
+
+    void OnWorkerExit()
+    {
+        WorkerContext::Bind(nullptr);
+    }
+
+    // a compensator only serves while the worker it stands in for is stalled
+    bool Serves(uint32_t workerId, bool compensator) const
+    {
+        return !compensator || _watchdog->IsStalled(workerId);
+    }
+
+    // the slot of a stalled worker is still in use, so tasks of its compensator are not watched
+    void OnTaskStart(uint32_t workerId, bool compensator, const Tag& tag)
+    {
+        if ((_watchdog != nullptr) && !compensator) {
+            _watchdog->OnTaskStart(workerId, tag.site);
+        }
+        if (_tracer != nullptr) {
+            _tracer->Record(TaskTracer::EventType::START, tag.traceId, tag.label);
+        }
+    }
+
+    void OnTaskEnd(uint32_t workerId, bool compensator, const Tag& tag)
+    {
+        if (_tracer != nullptr) {
+            _tracer->Record(TaskTracer::EventType::END, tag.traceId, tag.label);
+        }
+        if ((_watchdog != nullptr) && !compensator) {
+            _watchdog->OnTaskEnd(workerId);
+        }
+        WorkerContext::Current()->OnTaskEnd();
+    }
+
+private:
+    // temporary worker standing in for a stalled one
+    struct Compensator {
+        explicit Compensator(uint32_t workerId) : context(workerId)
+        {}
+
+        std::thread thread;
+        WorkerContext context;
+        std::atomic<uint32_t> done {0};
+    };
+
+    template<typename Wake>
+    void StartWatchdog(uint32_t workerNum, WorkerRunner runWorker, Wake&& wakeAll)
+    {
+        _runWorker = std::move(runWorker);
+        _watchdog = std::make_unique<Watchdog>(
+            workerNum, _stallThreshold, [this](const auto& report) { OnStall(report); },
+            // wake up the compensator of the recovered worker, so it can go away
+            [wakeAll = std::forward<Wake>(wakeAll)](uint32_t) { wakeAll(); });
+        _watchdog->Start();
+    }
+
+    void OnStall(const Watchdog::Report& report);
+
+    std::vector<std::unique_ptr<WorkerContext>> _contexts;
+    size_t _arenaChunkSize {0};
+    Clock::duration _stallThreshold {Clock::duration::zero()};
+    bool _compensate {false};
+    Watchdog::StallHandler _stallHandler;
+    WorkerRunner _runWorker;
+    std::unique_ptr<Watchdog> _watchdog;
+    std::mutex _compensatorLock;
+    std::list<Compensator> _compensators;
+    std::unique_ptr<TaskTracer> _tracer;
+};
+
+#endif  // SMALL_DEMOS_THREAD_POOL_FEATURES_H
@@ -0,0 +1,623 @@
+#ifndef SMALL_DEMOS_THREAD_POOL_POLICY_H
+#define SMALL_DEMOS_THREAD_POOL_POLICY_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <source_location>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "admission_controller.h"
+#include "bounded_channel.h"
+#include "slab_allocator.h"
+#include "unique_task.h"
+#include "utils/metrics.h"
+#include "utils/profiler.h"
+
+/**
+ * policies to assemble a BasicThreadPool at compile time, every policy only has to provide the members
+ * which the pool calls, so a feature which is not chosen costs nothing.
+ *
+ * queue policy, a template over the queued item:
+ *     Queue(uint32_t capacity, uint32_t workerNum)
+ *     bool TryPush(Item&& item)
+ *     bool TryPop(Item& item, uint32_t workerId)
+ *     bool Empty() const
+ * wait policy:
+ *     bool Idle(uint32_t workerId, Pred ready, Park canPark), waits until ready holds. false if the worker has
+ *         hibernated instead, which canPark allows, then it leaves its loop
+ *     void Resume(Pred running, Restart restart), restart(workerId) for each hibernated worker
+ *     void NotifyOne(), void NotifyAll()
+ * task policy:
+ *     using Type = ...
+ *     Type Make<R>(Func&& func, std::future<R>& future)
+ * stats policy, it is also where a pool is profiled:
+ *     void OnSubmit(), void OnReject(), void OnWorkerStart(), void OnWorkerExit()
+ *     auto Submit(F&& submit), gives submit() which does the whole of an AddTask
+ *     void Run(F& func), runs one task
+ * admission policy:
+ *     struct Stamp
+ *     bool Admit(Stamp& stamp), void OnDequeue(const Stamp& stamp)
+ * hooks policy, see PoolHooks in thread_pool_features.h for the one which does something:
+ *     struct Tag, what a task carries from its submit to its run
+ *     void Init(uint32_t workerNum, Runner runWorker, Wake wakeAll), void Stop(), void Join()
+ *     void OnSubmit(Tag& tag, const std::source_location& site), void OnQueued(const Tag& tag)
+ *     void OnWorkerStart(uint32_t workerId, bool compensator), void OnWorkerExit()
+ *     bool Serves(uint32_t workerId, bool compensator)
+ *     void OnTaskStart(uint32_t workerId, bool compensator, const Tag& tag), void OnTaskEnd(... the same)
+ */
+
+// ---------------------------------------- queue policy ----------------------------------------
+
+// one std::queue protected by one mutex, the most general one
+template<typename Item>
+class LockedQueue {
+public:
+    LockedQueue(uint32_t capacity, uint32_t /* workerNum */) : _capacity(capacity)
+    {}
+
+    bool TryPush(Item&& item)
+    {
+        std::lock_guard<std::mutex> lock {_lock};
+        if (_queue.size() >= _capacity) {
+            return false;
+        }
+
+        _queue.push(std::move(item));
+        _size.store(static_cast<uint32_t>(_queue.size()), std::memory_order_relaxed);
+        return true;
+    }
+
+    bool TryPop(Item& item, uint32_t /* workerId */)
+    {
+        std::lock_guard<std::mutex> lock {_lock};
+        if (_queue.empty()) {
+            return false;
+        }
+
+        item = std::move(_queue.front());
+        _queue.pop();
+        _size.store(static_cast<uint32_t>(_queue.size()), std::memory_order_relaxed);
+        return true;
+    }
+
+    bool Empty() const
+    {
+        return _size.load(std::memory_order_relaxed) == 0;
+    }
+
+private:
+    uint32_t _capacity;
+    std::mutex _lock;
+    std::queue<Item> _queue;
+    // mirror of _queue.size(), so waiters can check it without the lock
+    std::atomic<uint32_t> _size {0};
+};
+
+// lock-free ring buffer shared by all workers
+template<typename Item>
+class LockFreeQueue {
+public:
+    LockFreeQueue(uint32_t capacity, uint32_t /* workerNum */) : _capacity(capacity), _channel(capacity)
+    {}
+
+    bool TryPush(Item&& item)
+    {
+        // channel rounds its capacity up to power of 2, so the exact capacity is checked here
+        if (_size.fetch_add(1) >= _capacity) {
+            _size.fetch_sub(1);
+            return false;
+        }
+
+        if (!_channel.TryPush(std::move(item))) {
+            _size.fetch_sub(1);
+            return false;
+        }
+        return true;
+    }
+
+    bool TryPop(Item& item, uint32_t /* workerId */)
+    {
+        if (!_channel.TryPop(item)) {
+            return false;
+        }
+
+        _size.fetch_sub(1);
+        return true;
+    }
+
+    bool Empty() const
+    {
+        return _size.load(std::memory_order_relaxed) == 0;
+    }
+
+private:
+    uint32_t _capacity;
+    BoundedChannel<Item> _channel;
+    std::atomic<uint32_t> _size {0};
+};
+
+// one queue for each worker, tasks are spread round-robin and idle workers steal from the others
+template<typename Item>
+class PerWorkerQueue {
+public:
+    PerWorkerQueue(uint32_t capacity, uint32_t workerNum) : _capacity(capacity), _queues(workerNum)
+    {}
+
+    bool TryPush(Item&& item)
+    {
+        if (_size.fetch_add(1) >= _capacity) {
+            _size.fetch_sub(1);
+            return false;
+        }
+
+        auto& queue = _queues[_next.fetch_add(1, std::memory_order_relaxed) % _queues.size()];
+        std::lock_guard<std::mutex> lock {queue.lock};
+        queue.items.push_back(std::move(item));
+        return true;
+    }
+
+    bool TryPop(Item& item, uint32_t workerId)
+    {
+        // own queue first, then the neighbours
+        for (size_t i = 0; i < _queues.size(); i++) {
+            auto& queue = _queues[(workerId + i) % _queues.size()];
+            std::lock_guard<std::mutex> lock {queue.lock};
+            if (!queue.items.empty()) {
+                item = std::move(queue.items.front());
+                queue.items.pop_front();
+                _size.fetch_sub(1);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool Empty() const
+    {
+        return _size.load(std::memory_order_relaxed) == 0;
+    }
+
+private:
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+    struct alignas(CACHE_LINE_SIZE) WorkerQueue {
+        std::mutex lock;
+        std::deque<Item> items;
+    };
+
+    uint32_t _capacity;
+    std::vector<WorkerQueue> _queues;
+    std::atomic<uint32_t> _next {0};
+    std::atomic<uint32_t> _size {0};
+};
+
+// ---------------------------------------- wait policy ----------------------------------------
+
+// idle workers sleep on a condition variable
+class BlockingWait {
+public:
+    template<typename Pred, typename Park>
+    bool Idle(uint32_t /* workerId */, Pred ready, Park /* canPark */)
+    {
+        Wait(ready);
+        return true;
+    }
+
+    template<typename Pred, typename Restart>
+    void Resume(Pred /* running */, Restart /* restart */)
+    {}
+
+    template<typename Pred>
+    void Wait(Pred pred)
+    {
+        std::unique_lock<std::mutex> lock {_lock};
+        _sleepers.fetch_add(1, std::memory_order_relaxed);
+        // pairs with the fence in NotifyOne: either the waiter sees the new task or the notifier sees the waiter
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        _cv.wait(lock, pred);
+        _sleepers.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    template<typename Pred, typename Duration>
+    bool WaitFor(Pred pred, Duration timeout)
+    {
+        std::unique_lock<std::mutex> lock {_lock};
+        _sleepers.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool ready = _cv.wait_for(lock, timeout, pred);
+        _sleepers.fetch_sub(1, std::memory_order_relaxed);
+        return ready;
+    }
+
+    void NotifyOne()
+    {
+        // skip the lock when nobody sleeps, which is the common case of a busy pool
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (_sleepers.load(std::memory_order_relaxed) == 0) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock {_lock};
+        _cv.notify_one();
+    }
+
+    void NotifyAll()
+    {
+        std::lock_guard<std::mutex> lock {_lock};
+        _cv.notify_all();
+    }
+
+private:
+    std::mutex _lock;
+    std::condition_variable _cv;
+    std::atomic<uint32_t> _sleepers {0};
+};
+
+// idle workers keep polling, lowest latency but a core is burnt for each of them
+class SpinWait {
+public:
+    template<typename Pred, typename Park>
+    bool Idle(uint32_t /* workerId */, Pred ready, Park /* canPark */)
+    {
+        Wait(ready);
+        return true;
+    }
+
+    template<typename Pred, typename Restart>
+    void Resume(Pred /* running */, Restart /* restart */)
+    {}
+
+    template<typename Pred>
+    void Wait(Pred pred)
+    {
+        while (!pred()) {
+            std::this_thread::yield();
+        }
+    }
+
+    template<typename Pred, typename Duration>
+    bool WaitFor(Pred pred, Duration timeout)
+    {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (!pred()) {
+            if (std::chrono::steady_clock::now() >= deadline) {
+                return false;
+            }
+            std::this_thread::yield();
+        }
+        return true;
+    }
+
+    void NotifyOne()
+    {}
+
+    void NotifyAll()
+    {}
+};
+
+// ---------------------------------------- task policy ----------------------------------------
+
+// std::function needs a copyable callable, so std::packaged_task has to be shared
+struct FunctionTask {
+    using Type = std::function<void()>;
+
+    template<typename R, typename Func>
+    Type Make(Func&& func, std::future<R>& future)
+    {
+        auto sharedTask = std::make_shared<std::packaged_task<R()>>(std::forward<Func>(func));
+        future = sharedTask->get_future();
+        return [sharedTask]() { (*sharedTask)(); };
+    }
+};
+
+// std::packaged_task is stored in place, one allocation less for each task
+struct MoveOnlyTask {
+    using Type = UniqueTask;
+
+    template<typename R, typename Func>
+    Type Make(Func&& func, std::future<R>& future)
+    {
+        std::packaged_task<R()> task(std::forward<Func>(func));
+        future = task.get_future();
+        return Type(std::move(task));
+    }
+};
+
+/**
+ * both the closure and the shared state of the future are placed on a SlabHeap owned by the pool,
+ * so a task costs no call to the global allocator, and freeing it on a worker does not defeat malloc caches.
+ */
+class SlabTask {
+public:
+    using Type = UniqueTask;
+
+    template<typename R, typename Func>
+    Type Make(Func&& func, std::future<R>& future)
+    {
+        // std::packaged_task can not take an allocator since C++17, std::promise still can
+        std::promise<R> promise(std::allocator_arg, SlabAllocator<R>(_heap));
+        future = promise.get_future();
+        auto closure = [promise = std::move(promise), func = std::forward<Func>(func)]() mutable {
+            try {
+                if constexpr (std::is_void_v<R>) {
+                    func();
+                    promise.set_value();
+                } else {
+                    promise.set_value(func());
+                }
+            } catch (...) {
+                promise.set_exception(std::current_exception());
+            }
+        };
+        return Type(SlabBox<decltype(closure)>(*_heap, std::move(closure)));
+    }
+
+    const SlabHeap& GetHeap() const
+    {
+        return *_heap;
+    }
+
+private:
+    std::shared_ptr<SlabHeap> _heap {std::make_shared<SlabHeap>()};
+};
+
+// ---------------------------------------- stats policy ----------------------------------------
+
+struct NoStats {
+    void OnSubmit()
+    {}
+
+    void OnReject()
+    {}
+
+    void OnWorkerStart()
+    {}
+
+    void OnWorkerExit()
+    {}
+
+    template<typename F>
+    auto Submit(F&& submit)
+    {
+        return submit();
+    }
+
+    template<typename F>
+    void Run(F& func)
+    {
+        func();
+    }
+};
+
+class AtomicStats {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Snapshot {
+        uint64_t submitted;
+        uint64_t rejected;
+        uint64_t executed;
+        std::chrono::nanoseconds busyTime;
+    };
+
+    void OnSubmit()
+    {
+        _submitted.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void OnReject()
+    {
+        _rejected.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void OnWorkerStart()
+    {}
+
+    void OnWorkerExit()
+    {}
+
+    template<typename F>
+    auto Submit(F&& submit)
+    {
+        PROFILE_ZONE("ThreadPool::AddTask");
+        return submit();
+    }
+
+    template<typename F>
+    void Run(F& func)
+    {
+        auto start = Clock::now();
+        {
+            PROFILE_ZONE("ThreadPool::RunTask");
+            func();
+        }
+        auto cost = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+        _busyNs.fetch_add(static_cast<uint64_t>(cost.count()), std::memory_order_relaxed);
+        _executed.fetch_add(1, std::memory_order_relaxed);
+        PROFILE_COUNT("ThreadPool done tasks", 1);
+    }
+
+    Snapshot Get() const
+    {
+        return {_submitted.load(std::memory_order_relaxed), _rejected.load(std::memory_order_relaxed),
+                _executed.load(std::memory_order_relaxed),
+                std::chrono::nanoseconds(_busyNs.load(std::memory_order_relaxed))};
+    }
+
+private:
+    std::atomic<uint64_t> _submitted {0};
+    std::atomic<uint64_t> _rejected {0};
+    std::atomic<uint64_t> _executed {0};
+    std::atomic<uint64_t> _busyNs {0};
+};
+
+/**
+ * publishes to the process wide Metrics, all pools using it add up to the same thread_pool.* metrics.
+ * the running workers are also kept for each pool, parked ones are not counted
+ */
+class MetricsStats {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    void OnSubmit()
+    {
+        _submitted.Add(1);
+    }
+
+    void OnReject()
+    {
+        _rejected.Add(1);
+    }
+
+    void OnWorkerStart()
+    {
+        _runningWorkers.Add(1);
+        _allRunningWorkers.Add(1);
+    }
+
+    void OnWorkerExit()
+    {
+        _runningWorkers.Add(-1);
+        _allRunningWorkers.Add(-1);
+    }
+
+    int64_t GetRunningWorkers() const
+    {
+        return _runningWorkers.Get();
+    }
+
+    template<typename F>
+    auto Submit(F&& submit)
+    {
+        PROFILE_ZONE("ThreadPool::AddTask");
+        return submit();
+    }
+
+    template<typename F>
+    void Run(F& func)
+    {
+        auto start = Clock::now();
+        {
+            PROFILE_ZONE("ThreadPool::RunTask");
+            func();
+        }
+        auto cost = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+        _taskNs.Record(static_cast<uint64_t>(cost.count()));
+        _executed.Add(1);
+        PROFILE_COUNT("ThreadPool done tasks", 1);
+    }
+
+private:
+    Metrics::Counter& _submitted {Metrics::GetCounter("thread_pool.submitted")};
+    Metrics::Counter& _rejected {Metrics::GetCounter("thread_pool.rejected")};
+    Metrics::Counter& _executed {Metrics::GetCounter("thread_pool.executed")};
+    Metrics::Histogram& _taskNs {Metrics::GetHistogram("thread_pool.task_ns")};
+    Metrics::Gauge& _allRunningWorkers {Metrics::GetGauge("thread_pool.running_workers")};
+    Metrics::Gauge _runningWorkers;
+};
+
+// ---------------------------------------- admission policy ----------------------------------------
+
+struct NoAdmission {
+    struct Stamp {};
+
+    bool Admit(Stamp&)
+    {
+        return true;
+    }
+
+    void OnDequeue(const Stamp&)
+    {}
+};
+
+// see AdmissionController, it is off until Enable is called
+class CoDelAdmission {
+public:
+    using Clock = AdmissionController::Clock;
+
+    struct Stamp {
+        Clock::time_point enqueueTime;
+    };
+
+    void Enable(Clock::duration target, Clock::duration interval)
+    {
+        _controller = std::make_unique<AdmissionController>(target, interval);
+    }
+
+    bool Admit(Stamp& stamp)
+    {
+        if (_controller == nullptr) {
+            return true;
+        }
+
+        stamp.enqueueTime = Clock::now();
+        return _controller->Admit(stamp.enqueueTime);
+    }
+
+    void OnDequeue(const Stamp& stamp)
+    {
+        if (_controller != nullptr) {
+            auto now = Clock::now();
+            _controller->OnDequeue(now - stamp.enqueueTime, now);
+        }
+    }
+
+    double GetShedRate() const
+    {
+        return (_controller == nullptr) ? 0.0 : _controller->GetShedRate();
+    }
+
+private:
+    std::unique_ptr<AdmissionController> _controller;
+};
+
+// ---------------------------------------- hooks policy ----------------------------------------
+
+struct NoHooks {
+    struct Tag {};
+
+    template<typename Runner, typename Wake>
+    void Init(uint32_t /* workerNum */, Runner&& /* runWorker */, Wake&& /* wakeAll */)
+    {}
+
+    void Stop()
+    {}
+
+    void Join()
+    {}
+
+    void OnSubmit(Tag&, const std::source_location&)
+    {}
+
+    void OnQueued(const Tag&)
+    {}
+
+    void OnWorkerStart(uint32_t, bool)
+    {}
+
+    void OnWorkerExit()
+    {}
+
+    bool Serves(uint32_t, bool) const
+    {
+        return true;
+    }
+
+    void OnTaskStart(uint32_t, bool, const Tag&)
+    {}
+
+    void OnTaskEnd(uint32_t, bool, const Tag&)
+    {}
+};
+
+#endif  // SMALL_DEMOS_THREAD_POOL_POLICY_H
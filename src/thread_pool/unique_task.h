@@ -0,0 +1,117 @@
+#ifndef SMALL_DEMOS_UNIQUE_TASK_H
+#define SMALL_DEMOS_UNIQUE_TASK_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/**
+ * move-only replacement of std::function<void()>.
+ * move-only callables such as std::packaged_task can be stored directly without a shared_ptr around them,
+ * and small ones are kept in an inline buffer, so most tasks need no extra allocation.
+ */
+class UniqueTask {
+public:
+    UniqueTask() = default;
+
+    template<typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, UniqueTask>>>
+    UniqueTask(F&& func)  // NOLINT: implicit conversion like std::function
+    {
+        using Func = std::decay_t<F>;
+        if constexpr (IsInline<Func>()) {
+            new (_storage) Func(std::forward<F>(func));
+            _ops = &INLINE_OPS<Func>;
+        } else {
+            new (_storage) Func*(new Func(std::forward<F>(func)));
+            _ops = &HEAP_OPS<Func>;
+        }
+    }
+
+    ~UniqueTask()
+    {
+        Reset();
+    }
+
+    UniqueTask(UniqueTask&& other) noexcept
+    {
+        MoveFrom(other);
+    }
+
+    UniqueTask& operator=(UniqueTask&& other) noexcept
+    {
+        if (this != &other) {
+            Reset();
+            MoveFrom(other);
+        }
+        return *this;
+    }
+
+    UniqueTask(const UniqueTask&) = delete;
+    UniqueTask& operator=(const UniqueTask&) = delete;
+
+    void operator()()
+    {
+        _ops->invoke(_storage);
+    }
+
+    explicit operator bool() const
+    {
+        return _ops != nullptr;
+    }
+
+private:
+    static constexpr size_t INLINE_SIZE = 48;
+
+    struct Ops {
+        void (*invoke)(void* storage);
+        void (*move)(void* dst, void* src);
+        void (*destroy)(void* storage);
+    };
+
+    template<typename Func>
+    static constexpr bool IsInline()
+    {
+        return (sizeof(Func) <= INLINE_SIZE) && (alignof(Func) <= alignof(std::max_align_t))
+               && std::is_nothrow_move_constructible_v<Func>;
+    }
+
+    template<typename Func>
+    static constexpr Ops INLINE_OPS = {
+        [](void* storage) { (*static_cast<Func*>(storage))(); },
+        [](void* dst, void* src) {
+            new (dst) Func(std::move(*static_cast<Func*>(src)));
+            static_cast<Func*>(src)->~Func();
+        },
+        [](void* storage) { static_cast<Func*>(storage)->~Func(); },
+    };
+
+    template<typename Func>
+    static constexpr Ops HEAP_OPS = {
+        [](void* storage) { (**static_cast<Func**>(storage))(); },
+        [](void* dst, void* src) { new (dst) Func*(*static_cast<Func**>(src)); },
+        [](void* storage) { delete *static_cast<Func**>(storage); },
+    };
+
+    void Reset()
+    {
+        if (_ops != nullptr) {
+            _ops->destroy(_storage);
+            _ops = nullptr;
+        }
+    }
+
+    void MoveFrom(UniqueTask& other)
+    {
+        if (other._ops != nullptr) {
+            other._ops->move(_storage, other._storage);
+            _ops = other._ops;
+            other._ops = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) unsigned char _storage[INLINE_SIZE];
+    const Ops* _ops {nullptr};
+};
+
+#endif  // SMALL_DEMOS_UNIQUE_TASK_H
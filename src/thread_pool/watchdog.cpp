@@ -0,0 +1,118 @@
+#include "watchdog.h"
+#include <algorithm>
+
+Watchdog::Watchdog(uint32_t workerNum, Clock::duration threshold, StallHandler onStall, RecoverHandler onRecover) :
+    _workerNum(workerNum),
+    _threshold(threshold),
+    _onStall(std::move(onStall)),
+    _onRecover(std::move(onRecover)),
+    _slots(std::make_unique<WorkerSlot[]>(workerNum))
+{}
+
+Watchdog::~Watchdog()
+{
+    Stop();
+}
+
+void Watchdog::Start()
+{
+    std::lock_guard<std::mutex> lock {_lock};
+    if (_running) {
+        return;
+    }
+
+    _running = true;
+    _thread = std::thread(&Watchdog::Loop, this);
+}
+
+void Watchdog::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock {_lock};
+        _running = false;
+    }
+    _cv.notify_all();
+
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+}
+
+void Watchdog::OnTaskStart(uint32_t workerId, const std::source_location& site)
+{
+    auto& slot = _slots[workerId];
+    slot.file.store(site.file_name(), std::memory_order_relaxed);
+    slot.line.store(site.line(), std::memory_order_relaxed);
+    slot.function.store(site.function_name(), std::memory_order_relaxed);
+    // publish the call site together with the start time
+    slot.startNs.store(NowNs(), std::memory_order_release);
+}
+
+void Watchdog::OnTaskEnd(uint32_t workerId)
+{
+    _slots[workerId].startNs.store(0, std::memory_order_release);
+}
+
+bool Watchdog::IsStalled(uint32_t workerId) const
+{
+    return _slots[workerId].stalledStartNs.load(std::memory_order_acquire) != 0;
+}
+
+void Watchdog::Loop()
+{
+    // check twice in a threshold, so a stalled task is reported at most half a threshold late
+    constexpr uint32_t CHECKS_PER_THRESHOLD = 2;
+    auto interval = std::max<Clock::duration>(_threshold / CHECKS_PER_THRESHOLD, std::chrono::milliseconds(1));
+
+    std::unique_lock<std::mutex> lock {_lock};
+    while (_running) {
+        _cv.wait_for(lock, interval, [this]() { return !_running; });
+        if (!_running) {
+            break;
+        }
+
+        lock.unlock();
+        auto nowNs = NowNs();
+        for (uint32_t i = 0; i < _workerNum; i++) {
+            Check(i, nowNs);
+        }
+        lock.lock();
+    }
+}
+
+void Watchdog::Check(uint32_t workerId, int64_t nowNs)
+{
+    auto& slot = _slots[workerId];
+    int64_t startNs = slot.startNs.load(std::memory_order_acquire);
+    int64_t stalledStartNs = slot.stalledStartNs.load(std::memory_order_relaxed);
+
+    // the reported task has finished
+    if ((stalledStartNs != 0) && (startNs != stalledStartNs)) {
+        slot.stalledStartNs.store(0, std::memory_order_release);
+        if (_onRecover) {
+            _onRecover(workerId);
+        }
+    }
+
+    if ((startNs == 0) || (startNs == stalledStartNs)) {
+        return;
+    }
+
+    auto elapsed = std::chrono::nanoseconds(nowNs - startNs);
+    if (elapsed < _threshold) {
+        return;
+    }
+
+    Report report {workerId, elapsed, slot.file.load(std::memory_order_relaxed),
+                   slot.line.load(std::memory_order_relaxed), slot.function.load(std::memory_order_relaxed)};
+    // the worker may have moved on to another task while the call site was being read
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.startNs.load(std::memory_order_relaxed) != startNs) {
+        return;
+    }
+
+    slot.stalledStartNs.store(startNs, std::memory_order_release);
+    if (_onStall) {
+        _onStall(report);
+    }
+}
@@ -0,0 +1,85 @@
+#ifndef SMALL_DEMOS_WATCHDOG_H
+#define SMALL_DEMOS_WATCHDOG_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <source_location>
+#include <thread>
+
+/**
+ * a background thread which looks at the start time of the task each worker is running,
+ * and reports the ones which have been running longer than threshold, together with where they were submitted.
+ * workers only do two atomic stores for each task, all the checking is done by the watchdog thread.
+ */
+class Watchdog {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Report {
+        uint32_t workerId;
+        Clock::duration elapsed;
+        const char* file;
+        uint32_t line;
+        const char* function;
+    };
+
+    using StallHandler = std::function<void(const Report&)>;
+    using RecoverHandler = std::function<void(uint32_t workerId)>;
+
+    Watchdog(uint32_t workerNum, Clock::duration threshold, StallHandler onStall, RecoverHandler onRecover);
+    ~Watchdog();
+
+    Watchdog(const Watchdog&) = delete;
+    Watchdog& operator=(const Watchdog&) = delete;
+    Watchdog(const Watchdog&&) = delete;
+    Watchdog& operator=(const Watchdog&&) = delete;
+
+    void Start();
+    void Stop();
+
+    // called by worker around each task
+    void OnTaskStart(uint32_t workerId, const std::source_location& site);
+    void OnTaskEnd(uint32_t workerId);
+
+    // the task of this worker has been reported and is still running
+    bool IsStalled(uint32_t workerId) const;
+
+private:
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+    struct alignas(CACHE_LINE_SIZE) WorkerSlot {
+        // 0 means the worker is idle
+        std::atomic<int64_t> startNs {0};
+        std::atomic<const char*> file {nullptr};
+        std::atomic<uint32_t> line {0};
+        std::atomic<const char*> function {nullptr};
+        // start time of the reported task, only written by the watchdog thread
+        std::atomic<int64_t> stalledStartNs {0};
+    };
+
+    static int64_t NowNs()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+    }
+
+    void Loop();
+    void Check(uint32_t workerId, int64_t nowNs);
+
+    uint32_t _workerNum;
+    Clock::duration _threshold;
+    StallHandler _onStall;
+    RecoverHandler _onRecover;
+    std::unique_ptr<WorkerSlot[]> _slots;
+
+    std::thread _thread;
+    std::mutex _lock;
+    std::condition_variable _cv;
+    bool _running {false};
+};
+
+#endif  // SMALL_DEMOS_WATCHDOG_H
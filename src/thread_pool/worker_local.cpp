@@ -0,0 +1,49 @@
+#include "worker_local.h"
+#include <algorithm>
+
+void ScratchArena::Reset()
+{
+    // merge the chunks of a task which needed more than one, so the next such task fits in a single chunk
+    if (_chunks.size() > 1) {
+        size_t total = 0;
+        for (const auto& chunk : _chunks) {
+            total += chunk.size;
+        }
+
+        _chunks.clear();
+        _chunks.push_back({std::unique_ptr<std::byte[]>(new std::byte[total]), total});
+    }
+
+    _curChunk = 0;
+    _offset = 0;
+}
+
+size_t ScratchArena::Capacity() const
+{
+    size_t total = 0;
+    for (const auto& chunk : _chunks) {
+        total += chunk.size;
+    }
+    return total;
+}
+
+void* ScratchArena::do_allocate(size_t bytes, size_t alignment)
+{
+    while (_curChunk < _chunks.size()) {
+        auto& chunk = _chunks[_curChunk];
+        auto base = reinterpret_cast<uintptr_t>(chunk.data.get());
+        uintptr_t start = (base + _offset + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+        if (start + bytes <= base + chunk.size) {
+            _offset = start + bytes - base;
+            return reinterpret_cast<void*>(start);
+        }
+
+        _curChunk++;
+        _offset = 0;
+    }
+
+    size_t size = std::max(_chunkSize, bytes + alignment);
+    _chunks.push_back({std::unique_ptr<std::byte[]>(new std::byte[size]), size});
+    _curChunk = _chunks.size() - 1;
+    return do_allocate(bytes, alignment);
+}
@@ -0,0 +1,147 @@
+#ifndef SMALL_DEMOS_WORKER_LOCAL_H
+#define SMALL_DEMOS_WORKER_LOCAL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+/**
+ * bump allocator owned by one worker. memory is given back all at once by Reset after each task,
+ * and the chunks are kept for the next task, so scratch buffers do not go to the global allocator again.
+ * it is a std::pmr::memory_resource, so std::pmr containers can be built on it directly.
+ */
+class ScratchArena : public std::pmr::memory_resource {
+public:
+    explicit ScratchArena(size_t chunkSize) : _chunkSize(chunkSize)
+    {}
+    ~ScratchArena() override = default;
+
+    ScratchArena(const ScratchArena&) = delete;
+    ScratchArena& operator=(const ScratchArena&) = delete;
+    ScratchArena(const ScratchArena&&) = delete;
+    ScratchArena& operator=(const ScratchArena&&) = delete;
+
+    // everything allocated before is invalid after it
+    void Reset();
+    size_t Capacity() const;
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    // single block is never freed, they are all given back by Reset
+    void do_deallocate(void*, size_t, size_t) override
+    {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+
+private:
+    struct Chunk {
+        std::unique_ptr<std::byte[]> data;
+        size_t size;
+    };
+
+    size_t _chunkSize;
+    std::vector<Chunk> _chunks;
+    size_t _curChunk {0};
+    size_t _offset {0};
+};
+
+/**
+ * per-worker storage which tasks can reach by WorkerContext::Current().
+ * typed slots are created at the first use on a worker, and then reused by all later tasks on the same worker.
+ */
+class WorkerContext {
+public:
+    explicit WorkerContext(uint32_t workerId) : _workerId(workerId)
+    {}
+    ~WorkerContext() = default;
+
+    WorkerContext(const WorkerContext&) = delete;
+    WorkerContext& operator=(const WorkerContext&) = delete;
+    WorkerContext(const WorkerContext&&) = delete;
+    WorkerContext& operator=(const WorkerContext&&) = delete;
+
+    // context of the worker running the calling thread, nullptr if it is not a worker of any pool
+    static WorkerContext* Current()
+    {
+        return _current;
+    }
+
+    // called by the worker itself when it starts and stops
+    static void Bind(WorkerContext* context)
+    {
+        _current = context;
+    }
+
+    uint32_t WorkerId() const
+    {
+        return _workerId;
+    }
+
+    template<typename T>
+    T& Local();
+
+    // nullptr unless the pool has been asked for arenas
+    ScratchArena* Arena() const
+    {
+        return _arena.get();
+    }
+
+    void EnableArena(size_t chunkSize)
+    {
+        _arena = std::make_unique<ScratchArena>(chunkSize);
+    }
+
+    // called by the worker after each task
+    void OnTaskEnd()
+    {
+        if (_arena != nullptr) {
+            _arena->Reset();
+        }
+    }
+
+private:
+    struct SlotBase {
+        virtual ~SlotBase() = default;
+    };
+
+    template<typename T>
+    struct Slot : SlotBase {
+        T value {};
+    };
+
+    // every type gets a fixed index the first time it is used, so a slot is found without any hash
+    template<typename T>
+    static size_t SlotIndex()
+    {
+        static const size_t index = _slotNum.fetch_add(1);
+        return index;
+    }
+
+    static inline thread_local WorkerContext* _current {nullptr};
+    static inline std::atomic<size_t> _slotNum {0};
+
+    uint32_t _workerId;
+    std::vector<std::unique_ptr<SlotBase>> _slots;
+    std::unique_ptr<ScratchArena> _arena;
+};
+
+template<typename T>
+T& WorkerContext::Local()
+{
+    size_t index = SlotIndex<T>();
+    if (index >= _slots.size()) {
+        _slots.resize(index + 1);
+    }
+
+    if (_slots[index] == nullptr) {
+        _slots[index] = std::make_unique<Slot<T>>();
+    }
+    return static_cast<Slot<T>*>(_slots[index].get())->value;
+}
+
+#endif  // SMALL_DEMOS_WORKER_LOCAL_H
@@ -0,0 +1,192 @@
+#include "async_logger.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+AsyncLogger::AsyncLogger(FILE* out, size_t bufferSize, FullPolicy policy, std::chrono::milliseconds flushInterval) :
+    _loggerId(_nextLoggerId.fetch_add(1)),
+    _out(out),
+    _bufferSize(std::max<size_t>(bufferSize, 1)),
+    _policy(policy),
+    _flushInterval(flushInterval)
+{
+    _flusher = std::thread(&AsyncLogger::FlushLoop, this);
+}
+
+AsyncLogger::~AsyncLogger()
+{
+    Stop();
+}
+
+AsyncLogger& AsyncLogger::Default()
+{
+    constexpr size_t DEFAULT_BUFFER_SIZE = 64 * 1024;
+    constexpr std::chrono::milliseconds DEFAULT_FLUSH_INTERVAL {10};
+    static AsyncLogger* logger = []() {
+        auto created = new AsyncLogger(stdout, DEFAULT_BUFFER_SIZE, FullPolicy::BLOCK, DEFAULT_FLUSH_INTERVAL);
+        (void)std::atexit([]() { Default().Stop(); });
+        return created;
+    }();
+    return *logger;
+}
+
+AsyncLogger::ThreadBuffer* AsyncLogger::LocalBuffer()
+{
+    // a thread usually logs to one logger only, so one cached entry is enough to skip the lock
+    struct Cache {
+        uint64_t loggerId;
+        ThreadBuffer* buffer;
+    };
+    static thread_local Cache cache {0, nullptr};
+    if (cache.loggerId == _loggerId) {
+        return cache.buffer;
+    }
+
+    // a buffer is kept after its thread exits, a thread reusing the id takes it over
+    std::lock_guard<std::mutex> lock {_buffersLock};
+    auto& buffer = _buffers[std::this_thread::get_id()];
+    if (buffer == nullptr) {
+        buffer = std::make_unique<ThreadBuffer>(_bufferSize);
+    }
+
+    cache = {_loggerId, buffer.get()};
+    return buffer.get();
+}
+
+void AsyncLogger::Write(const char* text, size_t len)
+{
+    auto buffer = LocalBuffer();
+    len = std::min(len, buffer->capacity);
+    while (true) {
+        if (_stopped.load(std::memory_order_relaxed) != 0) {
+            std::lock_guard<std::mutex> lock {_flushLock};
+            std::string record(text, len);
+            if (_batchFilter != nullptr) {
+                (*_batchFilter)(record);
+            }
+            (void)fwrite(record.data(), 1, record.size(), _out);
+            (void)fflush(_out);
+            return;
+        }
+
+        uint64_t head = buffer->head.load(std::memory_order_relaxed);
+        uint64_t tail = buffer->tail.load(std::memory_order_acquire);
+        if (buffer->capacity - (head - tail) >= len) {
+            size_t pos = head % buffer->capacity;
+            size_t first = std::min(len, buffer->capacity - pos);
+            std::memcpy(buffer->data.get() + pos, text, first);
+            std::memcpy(buffer->data.get(), text + first, len - first);
+            buffer->head.store(head + len, std::memory_order_release);
+
+            // the flusher is only woken up early when the buffer fills up, most records wait for its interval
+            if ((head + len - tail) * 2 > buffer->capacity) {
+                std::lock_guard<std::mutex> lock {_flushLock};
+                _wakeUp = true;
+                _flushCv.notify_one();
+            }
+            return;
+        }
+
+        if (_policy == FullPolicy::DROP) {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock {_flushLock};
+            _wakeUp = true;
+            _flushCv.notify_one();
+        }
+        std::this_thread::yield();
+    }
+}
+
+void AsyncLogger::SetBatchFilter(BatchFilter filter)
+{
+    std::lock_guard<std::mutex> lock {_flushLock};
+    _batchFilter = std::make_shared<const BatchFilter>(std::move(filter));
+}
+
+void AsyncLogger::Flush()
+{
+    std::unique_lock<std::mutex> lock {_flushLock};
+    if (_stopped.load(std::memory_order_relaxed) != 0) {
+        return;
+    }
+
+    uint64_t target = ++_flushRequested;
+    _flushCv.notify_one();
+    _flushedCv.wait(lock, [this, target]() { return (_flushed >= target) || (_stopped.load() != 0); });
+}
+
+void AsyncLogger::Drain(std::string& batch)
+{
+    std::lock_guard<std::mutex> lock {_buffersLock};
+    for (auto& [id, buffer] : _buffers) {
+        uint64_t tail = buffer->tail.load(std::memory_order_relaxed);
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+        for (uint64_t pos = tail; pos < head;) {
+            size_t offset = pos % buffer->capacity;
+            size_t len = std::min<uint64_t>(head - pos, buffer->capacity - offset);
+            batch.append(buffer->data.get() + offset, len);
+            pos += len;
+        }
+        buffer->tail.store(head, std::memory_order_release);
+    }
+}
+
+void AsyncLogger::FlushLoop()
+{
+    std::string batch;
+    std::unique_lock<std::mutex> lock {_flushLock};
+    while (true) {
+        _flushCv.wait_for(lock, _flushInterval, [this]() {
+            return _wakeUp || (_flushRequested > _flushed) || (_stopped.load() != 0);
+        });
+        _wakeUp = false;
+        uint64_t requested = _flushRequested;
+        bool stopped = (_stopped.load() != 0);
+        lock.unlock();
+
+        batch.clear();
+        Drain(batch);
+        // read after the records, so a filter set before a record was written is always seen here
+        std::shared_ptr<const BatchFilter> filter;
+        {
+            std::lock_guard<std::mutex> filterLock {_flushLock};
+            filter = _batchFilter;
+        }
+        if (!batch.empty() && (filter != nullptr)) {
+            (*filter)(batch);
+        }
+        if (!batch.empty()) {
+            // one write for all threads, this is what takes the terminal I/O off the logging threads
+            (void)fwrite(batch.data(), 1, batch.size(), _out);
+            (void)fflush(_out);
+        }
+
+        lock.lock();
+        _flushed = requested;
+        _flushedCv.notify_all();
+        if (stopped) {
+            return;
+        }
+    }
+}
+
+void AsyncLogger::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock {_flushLock};
+        if (_stopped.load() != 0) {
+            return;
+        }
+        _stopped.store(1);
+        _flushCv.notify_one();
+    }
+
+    // the flusher drains all buffers once more before it leaves
+    if (_flusher.joinable()) {
+        _flusher.join();
+    }
+}
@@ -0,0 +1,101 @@
+#ifndef SMALL_DEMOS_ASYNC_LOGGER_H
+#define SMALL_DEMOS_ASYNC_LOGGER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+/**
+ * logger which keeps terminal or file I/O off the logging threads. every thread appends its records to a
+ * lock-free ring buffer of its own, and one flusher thread drains all buffers and writes them in one batch,
+ * every flushInterval or as soon as a buffer is half full.
+ * records of one thread keep their order, records of different threads are only ordered by flush batches.
+ */
+class AsyncLogger {
+public:
+    // what a thread does when its buffer has no room for a record
+    enum class FullPolicy
+    {
+        DROP,   // count it in GetDropped and go on
+        BLOCK,  // wait for the flusher, no record is lost
+    };
+
+    // rewrites a drained batch on the flusher before it is written, e.g. to format deferred records
+    using BatchFilter = std::function<void(std::string& batch)>;
+
+    AsyncLogger(FILE* out, size_t bufferSize, FullPolicy policy, std::chrono::milliseconds flushInterval);
+    ~AsyncLogger();
+
+    AsyncLogger(const AsyncLogger&) = delete;
+    AsyncLogger& operator=(const AsyncLogger&) = delete;
+    AsyncLogger(const AsyncLogger&&) = delete;
+    AsyncLogger& operator=(const AsyncLogger&&) = delete;
+
+    /**
+     * logger behind PRINT_INFO and PRINT_ERROR, writing to stdout. it is never destroyed, so it can still be
+     * used by destructors of other statics, and everything is flushed at exit.
+     */
+    static AsyncLogger& Default();
+
+    // append one complete record, a record longer than the buffer is cut
+    void Write(const char* text, size_t len);
+    // wait until every record written before is in the output
+    void Flush();
+    // records written after it returns are seen by the filter
+    void SetBatchFilter(BatchFilter filter);
+
+    uint64_t GetDropped() const
+    {
+        return _dropped.load(std::memory_order_relaxed);
+    }
+
+private:
+    // single producer (its thread) and single consumer (the flusher)
+    struct ThreadBuffer {
+        explicit ThreadBuffer(size_t size) : data(std::make_unique<char[]>(size)), capacity(size)
+        {}
+
+        std::unique_ptr<char[]> data;
+        size_t capacity;
+        std::atomic<uint64_t> head {0};
+        std::atomic<uint64_t> tail {0};
+    };
+
+    ThreadBuffer* LocalBuffer();
+    void FlushLoop();
+    void Drain(std::string& batch);
+    void Stop();
+
+    static inline std::atomic<uint64_t> _nextLoggerId {1};
+
+    uint64_t _loggerId;
+    FILE* _out;
+    size_t _bufferSize;
+    FullPolicy _policy;
+    std::chrono::milliseconds _flushInterval;
+    std::atomic<uint64_t> _dropped {0};
+
+    std::mutex _buffersLock;
+    std::unordered_map<std::thread::id, std::unique_ptr<ThreadBuffer>> _buffers;
+
+    std::mutex _flushLock;
+    std::condition_variable _flushCv;
+    std::condition_variable _flushedCv;
+    uint64_t _flushRequested {0};
+    uint64_t _flushed {0};
+    bool _wakeUp {false};
+    std::shared_ptr<const BatchFilter> _batchFilter;
+    // once stopped, records are written directly by the logging thread
+    std::atomic<uint32_t> _stopped {0};
+    std::thread _flusher;
+};
+
+#endif  // SMALL_DEMOS_ASYNC_LOGGER_H
@@ -0,0 +1,352 @@
+#include "binary_log.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include "async_logger.h"
+#include "utils.h"
+
+namespace {
+struct SiteRegistry {
+    std::mutex lock;
+    std::deque<LogSite> sites;
+};
+
+SiteRegistry& Registry()
+{
+    static SiteRegistry registry;
+    return registry;
+}
+
+std::atomic<uint32_t> g_rawOutput {0};
+// SITE frames already written in raw output
+std::atomic<uint32_t> g_emittedSites {0};
+
+template<typename T>
+bool Read(const char*& pos, const char* end, T& value)
+{
+    if (static_cast<size_t>(end - pos) < sizeof(T)) {
+        return false;
+    }
+    std::memcpy(&value, pos, sizeof(T));
+    pos += sizeof(T);
+    return true;
+}
+
+bool ReadString(const char*& pos, const char* end, std::string& str)
+{
+    uint32_t len;
+    if (!Read(pos, end, len) || (static_cast<size_t>(end - pos) < len)) {
+        return false;
+    }
+    str.assign(pos, len);
+    pos += len;
+    return true;
+}
+
+void AppendFrame(std::string& out, BinaryLog::FrameType type, const std::string& payload)
+{
+    auto size = static_cast<uint32_t>(payload.size());
+    out.push_back('\0');
+    out.push_back(static_cast<char>(type));
+    out.append(reinterpret_cast<const char*>(&size), sizeof(size));
+    out.append(payload);
+}
+
+template<typename T>
+void AppendValue(std::string& out, T value)
+{
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void AppendSiteFrames(std::string& out)
+{
+    auto& registry = Registry();
+    std::lock_guard<std::mutex> lock {registry.lock};
+    uint32_t from = g_emittedSites.load();
+    auto to = static_cast<uint32_t>(registry.sites.size());
+    if ((from == to) || !g_emittedSites.compare_exchange_strong(from, to)) {
+        return;
+    }
+
+    for (uint32_t id = from; id < to; id++) {
+        const auto& site = registry.sites[id];
+        std::string payload;
+        AppendValue(payload, id);
+        AppendValue(payload, static_cast<uint32_t>(site.level));
+        AppendValue(payload, static_cast<uint32_t>(site.line));
+        AppendValue(payload, static_cast<uint32_t>(strlen(site.file)));
+        payload.append(site.file);
+        AppendValue(payload, static_cast<uint32_t>(strlen(site.fmt)));
+        payload.append(site.fmt);
+        AppendFrame(out, BinaryLog::FrameType::SITE, payload);
+    }
+}
+
+// runs on the flusher of the default logger
+void FilterBatch(std::string& batch)
+{
+    if (std::memchr(batch.data(), '\0', batch.size()) == nullptr) {
+        return;
+    }
+
+    std::string out;
+    if (g_rawOutput.load() != 0) {
+        // the sites a record refers to are registered before it, so they are all in the registry by now
+        AppendSiteFrames(out);
+        out.append(batch);
+    } else {
+        BinaryLogDecoder decoder(true);
+        decoder.Decode(batch.data(), batch.size(), out);
+    }
+    batch.swap(out);
+}
+
+struct ArgReader {
+    const char* pos;
+    const char* end;
+
+    bool Next(BinaryLog::ArgTag& tag, uint64_t& bits, std::string& str)
+    {
+        uint8_t rawTag;
+        if (!Read(pos, end, rawTag)) {
+            return false;
+        }
+        tag = static_cast<BinaryLog::ArgTag>(rawTag);
+        return (tag == BinaryLog::ArgTag::STR) ? ReadString(pos, end, str) : Read(pos, end, bits);
+    }
+};
+
+template<typename T>
+void AppendFormatted(std::string& out, const std::string& spec, T value)
+{
+    int len = snprintf(nullptr, 0, spec.c_str(), value);
+    if (len <= 0) {
+        return;
+    }
+    size_t old = out.size();
+    out.resize(old + static_cast<size_t>(len) + 1);
+    (void)snprintf(&out[old], static_cast<size_t>(len) + 1, spec.c_str(), value);
+    out.resize(old + static_cast<size_t>(len));
+}
+
+// printf again with the recorded arguments, length modifiers are replaced by the width they were saved in
+void FormatArgs(const std::string& fmt, ArgReader reader, std::string& out)
+{
+    for (size_t i = 0; i < fmt.size(); i++) {
+        if ((fmt[i] != '%') || (i + 1 >= fmt.size())) {
+            out.push_back(fmt[i]);
+            continue;
+        }
+        if (fmt[i + 1] == '%') {
+            out.push_back('%');
+            i++;
+            continue;
+        }
+
+        std::string spec = "%";
+        size_t j = i + 1;
+        BinaryLog::ArgTag tag;
+        uint64_t bits = 0;
+        std::string str;
+        bool missing = false;
+        for (; (j < fmt.size()) && (strchr("-+ #0123456789.*", fmt[j]) != nullptr); j++) {
+            if (fmt[j] != '*') {
+                spec.push_back(fmt[j]);
+                continue;
+            }
+            // a width or precision given by *, it is an int argument before the value
+            if (!reader.Next(tag, bits, str)) {
+                missing = true;
+                continue;
+            }
+            auto value = static_cast<int>(static_cast<int64_t>(bits));
+            if ((value < 0) && (spec.back() == '.')) {
+                // a negative precision is taken as if it were not given
+                spec.pop_back();
+            } else {
+                // a negative width is a '-' flag, which the sign gives as it is
+                spec.append(std::to_string(value));
+            }
+        }
+        for (; (j < fmt.size()) && (strchr("hljztLq", fmt[j]) != nullptr); j++) {
+        }
+        if (j >= fmt.size()) {
+            break;
+        }
+        char conv = fmt[j];
+        i = j;
+
+        if (missing || !reader.Next(tag, bits, str)) {
+            out.append("<missing>");
+            continue;
+        }
+
+        double real;
+        std::memcpy(&real, &bits, sizeof(real));
+        auto integer = (tag == BinaryLog::ArgTag::F64) ? static_cast<uint64_t>(real) : bits;
+        if (strchr("di", conv) != nullptr) {
+            AppendFormatted(out, spec + "lld", static_cast<long long>(integer));
+        } else if (strchr("uoxX", conv) != nullptr) {
+            AppendFormatted(out, spec + "ll" + conv, static_cast<unsigned long long>(integer));
+        } else if (conv == 'c') {
+            AppendFormatted(out, spec + "c", static_cast<int>(integer));
+        } else if (strchr("fFeEgGaA", conv) != nullptr) {
+            auto value = (tag == BinaryLog::ArgTag::F64) ? real : static_cast<double>(static_cast<int64_t>(bits));
+            AppendFormatted(out, spec + conv, value);
+        } else if (conv == 's') {
+            const char* value = (tag == BinaryLog::ArgTag::STR) ? str.c_str() : "<not a string>";
+            AppendFormatted(out, spec + "s", value);
+        } else if (conv == 'p') {
+            AppendFormatted(out, spec + "p", reinterpret_cast<void*>(static_cast<uintptr_t>(bits)));
+        }
+    }
+}
+}  // namespace
+
+uint32_t BinaryLog::RegisterSite(const LogSite& site)
+{
+    auto& registry = Registry();
+    std::lock_guard<std::mutex> lock {registry.lock};
+    registry.sites.push_back(site);
+    return static_cast<uint32_t>(registry.sites.size() - 1);
+}
+
+bool BinaryLog::GetSite(uint32_t id, LogSite& site)
+{
+    auto& registry = Registry();
+    std::lock_guard<std::mutex> lock {registry.lock};
+    if (id >= registry.sites.size()) {
+        return false;
+    }
+    site = registry.sites[id];
+    return true;
+}
+
+void BinaryLog::SetRawOutput(bool raw)
+{
+    // the output starts over as a stream a decoder can read from its beginning, so all sites are written again
+    g_emittedSites.store(0);
+    g_rawOutput.store(raw ? 1 : 0);
+}
+
+void BinaryLog::RecordWriter::PutString(const char* str)
+{
+    if (str == nullptr) {
+        str = "(null)";
+    }
+
+    auto tag = ArgTag::STR;
+    if (_full || (static_cast<size_t>(_end - _pos) < 1 + sizeof(uint32_t))) {
+        _full = true;
+        return;
+    }
+
+    // cut to what is left, the arguments after a cut one are left out
+    (void)Put(&tag, 1);
+    size_t fullLen = strlen(str);
+    auto len = static_cast<uint32_t>(std::min(fullLen, static_cast<size_t>(_end - _pos) - sizeof(uint32_t)));
+    (void)Put(&len, sizeof(len));
+    (void)Put(str, len);
+    _full = (len < fullLen);
+}
+
+void BinaryLog::Commit(char* record, size_t size)
+{
+    // installed before the first record, the filter formats records on the flusher
+    static const bool installed = []() {
+        AsyncLogger::Default().SetBatchFilter(FilterBatch);
+        return true;
+    }();
+    (void)installed;
+
+    auto payloadSize = static_cast<uint32_t>(size - FRAME_HEADER_SIZE);
+    record[0] = '\0';
+    record[1] = static_cast<char>(FrameType::RECORD);
+    std::memcpy(record + 2, &payloadSize, sizeof(payloadSize));
+    AsyncLogger::Default().Write(record, size);
+}
+
+void BinaryLogDecoder::Decode(const char* data, size_t len, std::string& out)
+{
+    _rest.append(data, len);
+    size_t pos = 0;
+    while (pos < _rest.size()) {
+        if (_rest[pos] != '\0') {
+            size_t newline = _rest.find('\n', pos);
+            if (newline == std::string::npos) {
+                break;
+            }
+            out.append(_rest, pos, newline + 1 - pos);
+            pos = newline + 1;
+            continue;
+        }
+
+        if (_rest.size() - pos < BinaryLog::FRAME_HEADER_SIZE) {
+            break;
+        }
+        uint32_t size;
+        std::memcpy(&size, _rest.data() + pos + 2, sizeof(size));
+        if (_rest.size() - pos - BinaryLog::FRAME_HEADER_SIZE < size) {
+            break;
+        }
+        DecodeFrame(static_cast<BinaryLog::FrameType>(_rest[pos + 1]),
+                    _rest.data() + pos + BinaryLog::FRAME_HEADER_SIZE, size, out);
+        pos += BinaryLog::FRAME_HEADER_SIZE + size;
+    }
+    _rest.erase(0, pos);
+}
+
+bool BinaryLogDecoder::FindSite(uint32_t id, Site& site)
+{
+    if (_useProcessSites) {
+        LogSite logSite;
+        if (!BinaryLog::GetSite(id, logSite)) {
+            return false;
+        }
+        site = {logSite.level, static_cast<uint32_t>(logSite.line), logSite.file, logSite.fmt};
+        return true;
+    }
+
+    auto it = _sites.find(id);
+    if (it == _sites.end()) {
+        return false;
+    }
+    site = it->second;
+    return true;
+}
+
+void BinaryLogDecoder::DecodeFrame(BinaryLog::FrameType type, const char* payload, size_t size, std::string& out)
+{
+    const char* pos = payload;
+    const char* end = payload + size;
+    if (type == BinaryLog::FrameType::SITE) {
+        uint32_t id;
+        uint32_t level;
+        Site site;
+        if (Read(pos, end, id) && Read(pos, end, level) && Read(pos, end, site.line) &&
+            ReadString(pos, end, site.file) && ReadString(pos, end, site.fmt)) {
+            site.level = static_cast<int>(level);
+            _sites[id] = std::move(site);
+        }
+        return;
+    }
+
+    uint32_t siteId;
+    Site site;
+    if ((type != BinaryLog::FrameType::RECORD) || !Read(pos, end, siteId) || !FindSite(siteId, site)) {
+        out.append("[?] record of an unknown log site\n");
+        return;
+    }
+
+    size_t slash = site.file.rfind('/');
+    out.append("[").append(LogLevelName(site.level)).append("][");
+    out.append(site.file, (slash == std::string::npos) ? 0 : slash + 1).append(":");
+    out.append(std::to_string(site.line)).append("] ");
+    FormatArgs(site.fmt, ArgReader {pos, end}, out);
+    // one newline per record, as PrintLog does
+    if (out.back() != '\n') {
+        out.push_back('\n');
+    }
+}
@@ -0,0 +1,167 @@
+#ifndef SMALL_DEMOS_BINARY_LOG_H
+#define SMALL_DEMOS_BINARY_LOG_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+
+// one PRINT_* call site, fmt and file must be string literals
+struct LogSite {
+    int level;
+    const char* file;
+    int line;
+    const char* fmt;
+};
+
+/**
+ * deferred-formatting log records: a call site only copies the id of its LogSite and its raw arguments into
+ * the buffer of AsyncLogger::Default(), printf formatting is done later by the flusher, or offline by
+ * log_decoder when raw output is on.
+ *
+ * stream layout, text records are lines and never contain '\0':
+ *     frame  = '\0' type(u8) size(u32) payload
+ *     SITE   : id(u32) level(u32) line(u32) file(u32 size + bytes) fmt(u32 size + bytes)
+ *     RECORD : siteId(u32) { tag(u8) value }...
+ * strings are copied, so they may be gone by the time the record is formatted.
+ */
+class BinaryLog {
+public:
+    enum class FrameType : uint8_t
+    {
+        SITE = 1,
+        RECORD = 2,
+    };
+
+    enum class ArgTag : uint8_t
+    {
+        I64 = 1,
+        U64,
+        F64,
+        STR,
+        PTR,
+    };
+
+    static constexpr size_t FRAME_HEADER_SIZE = 1 + sizeof(uint8_t) + sizeof(uint32_t);
+    static constexpr size_t MAX_RECORD_SIZE = 512;
+
+    static uint32_t RegisterSite(const LogSite& site);
+    static bool GetSite(uint32_t id, LogSite& site);
+
+    // arguments which do not fit in MAX_RECORD_SIZE are left out, a long string is cut
+    template<typename... Args>
+    static void Write(uint32_t siteId, const Args&... args);
+
+    /**
+     * write frames as they are, together with the SITE frames they refer to, instead of formatting them.
+     * the output can be turned into text by log_decoder later.
+     */
+    static void SetRawOutput(bool raw);
+
+private:
+    class RecordWriter {
+    public:
+        RecordWriter(char* begin, size_t size) : _pos(begin), _end(begin + size)
+        {}
+
+        bool Put(const void* data, size_t len)
+        {
+            if (static_cast<size_t>(_end - _pos) < len) {
+                _full = true;
+                return false;
+            }
+            std::memcpy(_pos, data, len);
+            _pos += len;
+            return true;
+        }
+
+        template<typename T>
+        void PutArg(ArgTag tag, T value)
+        {
+            if (!_full && (static_cast<size_t>(_end - _pos) >= 1 + sizeof(T))) {
+                (void)Put(&tag, 1);
+                (void)Put(&value, sizeof(T));
+            } else {
+                _full = true;
+            }
+        }
+
+        void PutString(const char* str);
+
+        char* Pos() const
+        {
+            return _pos;
+        }
+
+    private:
+        char* _pos;
+        char* _end;
+        bool _full {false};
+    };
+
+    template<typename T>
+    static void Encode(RecordWriter& writer, const T& arg);
+    static void Commit(char* record, size_t size);
+};
+
+template<typename T>
+void BinaryLog::Encode(RecordWriter& writer, const T& arg)
+{
+    using Decayed = std::decay_t<T>;
+    if constexpr (std::is_enum_v<Decayed>) {
+        Encode(writer, static_cast<std::underlying_type_t<Decayed>>(arg));
+    } else if constexpr (std::is_integral_v<Decayed> && std::is_signed_v<Decayed>) {
+        writer.PutArg(ArgTag::I64, static_cast<int64_t>(arg));
+    } else if constexpr (std::is_integral_v<Decayed>) {
+        writer.PutArg(ArgTag::U64, static_cast<uint64_t>(arg));
+    } else if constexpr (std::is_floating_point_v<Decayed>) {
+        writer.PutArg(ArgTag::F64, static_cast<double>(arg));
+    } else if constexpr (std::is_same_v<Decayed, char*> || std::is_same_v<Decayed, const char*>) {
+        const char* str = arg;
+        writer.PutString(str);
+    } else if constexpr (std::is_same_v<Decayed, std::string>) {
+        writer.PutString(arg.c_str());
+    } else {
+        static_assert(std::is_pointer_v<Decayed>, "type can not be logged");
+        writer.PutArg(ArgTag::PTR, reinterpret_cast<uint64_t>(static_cast<const void*>(arg)));
+    }
+}
+
+template<typename... Args>
+void BinaryLog::Write(uint32_t siteId, const Args&... args)
+{
+    char record[MAX_RECORD_SIZE];
+    RecordWriter writer(record + FRAME_HEADER_SIZE, MAX_RECORD_SIZE - FRAME_HEADER_SIZE);
+    (void)writer.Put(&siteId, sizeof(siteId));
+    (Encode(writer, args), ...);
+    Commit(record, static_cast<size_t>(writer.Pos() - record));
+}
+
+// turns a stream of text lines and frames back into text
+class BinaryLogDecoder {
+public:
+    // sites are taken from this process if useProcessSites, otherwise from the SITE frames in the stream
+    explicit BinaryLogDecoder(bool useProcessSites) : _useProcessSites(useProcessSites)
+    {}
+
+    // an unfinished frame or line at the end of data is kept until the next call
+    void Decode(const char* data, size_t len, std::string& out);
+
+private:
+    struct Site {
+        int level;
+        uint32_t line;
+        std::string file;
+        std::string fmt;
+    };
+
+    void DecodeFrame(BinaryLog::FrameType type, const char* payload, size_t size, std::string& out);
+    bool FindSite(uint32_t id, Site& site);
+
+    bool _useProcessSites;
+    std::string _rest;
+    std::unordered_map<uint32_t, Site> _sites;
+};
+
+#endif  // SMALL_DEMOS_BINARY_LOG_H
@@ -0,0 +1,39 @@
+#include "chrome_trace.h"
+#include <iomanip>
+
+ChromeTraceWriter::ChromeTraceWriter(std::ostream& out) : _out(out)
+{
+    _out << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+}
+
+void ChromeTraceWriter::ThreadName(uint32_t tid, const std::string& name)
+{
+    Next() << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid << ",\"args\":{\"name\":\""
+           << Escape(name.c_str(), "") << "\"}}";
+}
+
+std::ostream& ChromeTraceWriter::Next()
+{
+    _out << _sep;
+    _sep = ",\n";
+    return _out;
+}
+
+void ChromeTraceWriter::Finish()
+{
+    _out << "\n]}\n";
+}
+
+std::string ChromeTraceWriter::Escape(const char* str, const char* fallback)
+{
+    std::string result;
+    for (const char* c = (str == nullptr) ? fallback : str; *c != '\0'; c++) {
+        if ((*c == '"') || (*c == '\\')) {
+            result.push_back('\\');
+        }
+        if (static_cast<unsigned char>(*c) >= 0x20) {
+            result.push_back(*c);
+        }
+    }
+    return result;
+}
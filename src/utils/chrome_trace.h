@@ -0,0 +1,47 @@
+#ifndef SMALL_DEMOS_CHROME_TRACE_H
+#define SMALL_DEMOS_CHROME_TRACE_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+/**
+ * writer of Chrome trace-event json, which can be opened by chrome://tracing or Perfetto. it writes the frame,
+ * the thread names and the separators, the fields of each event are up to the caller:
+ *
+ *     ChromeTraceWriter trace(out);
+ *     trace.ThreadName(1, "worker 0");
+ *     trace.Next() << "{\"name\":\"" << ChromeTraceWriter::Escape(name, "zone") << "\",\"ph\":\"B\",...}";
+ *     trace.Finish();
+ */
+class ChromeTraceWriter {
+public:
+    // numbers are written with 3 digits after the point, timestamps get nanosecond precision that way
+    explicit ChromeTraceWriter(std::ostream& out);
+
+    ChromeTraceWriter(const ChromeTraceWriter&) = delete;
+    ChromeTraceWriter& operator=(const ChromeTraceWriter&) = delete;
+    ChromeTraceWriter(const ChromeTraceWriter&&) = delete;
+    ChromeTraceWriter& operator=(const ChromeTraceWriter&&) = delete;
+
+    void ThreadName(uint32_t tid, const std::string& name);
+    // stream for the next event
+    std::ostream& Next();
+    void Finish();
+
+    // str without what would break the json string it goes into, fallback if it is nullptr
+    static std::string Escape(const char* str, const char* fallback);
+
+    // trace-event timestamps are microseconds
+    static double ToUs(int64_t ns)
+    {
+        constexpr double NS_PER_US = 1000.0;
+        return static_cast<double>(ns) / NS_PER_US;
+    }
+
+private:
+    std::ostream& _out;
+    const char* _sep {"\n"};
+};
+
+#endif  // SMALL_DEMOS_CHROME_TRACE_H
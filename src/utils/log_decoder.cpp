@@ -0,0 +1,28 @@
+#include <cstdio>
+#include <string>
+#include "binary_log.h"
+
+// turn a log written with BinaryLog::SetRawOutput(true) back into text: log_decoder [file]
+int main(int argc, char* argv[])
+{
+    FILE* in = (argc > 1) ? fopen(argv[1], "rb") : stdin;
+    if (in == nullptr) {
+        fprintf(stderr, "can not open %s.\n", argv[1]);
+        return 1;
+    }
+
+    BinaryLogDecoder decoder(false);
+    char buf[64 * 1024];
+    std::string out;
+    size_t len;
+    while ((len = fread(buf, 1, sizeof(buf), in)) > 0) {
+        out.clear();
+        decoder.Decode(buf, len, out);
+        (void)fwrite(out.data(), 1, out.size(), stdout);
+    }
+
+    if (in != stdin) {
+        (void)fclose(in);
+    }
+    return 0;
+}
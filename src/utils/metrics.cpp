@@ -0,0 +1,273 @@
+#include "metrics.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include "utils.h"
+
+namespace {
+std::string EscapeJson(const std::string& str)
+{
+    std::string result;
+    for (char c : str) {
+        if ((c == '"') || (c == '\\')) {
+            result.push_back('\\');
+        }
+        if (static_cast<unsigned char>(c) >= 0x20) {
+            result.push_back(c);
+        }
+    }
+    return result;
+}
+
+uint32_t HighestBit(uint64_t value)
+{
+    return 63 - static_cast<uint32_t>(__builtin_clzll(value));
+}
+
+// the percentiles which are exported, with their names
+constexpr std::pair<double, const char*> EXPORTED_PERCENTILES[] = {
+    {0.5, "p50"}, {0.9, "p90"}, {0.99, "p99"}, {0.999, "p999"}};
+}  // namespace
+
+int64_t Metrics::Counter::Get() const
+{
+    int64_t sum = 0;
+    for (const auto& shard : _shards) {
+        sum += shard.value.load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+size_t Metrics::Histogram::BucketOf(uint64_t value)
+{
+    if (value < SUB_BUCKET_NUM) {
+        return static_cast<size_t>(value);
+    }
+    uint32_t shift = HighestBit(value) - SUB_BUCKET_BITS;
+    return static_cast<size_t>((shift + 1) * SUB_BUCKET_NUM + ((value >> shift) - SUB_BUCKET_NUM));
+}
+
+uint64_t Metrics::Histogram::BucketLow(size_t bucket)
+{
+    if (bucket < SUB_BUCKET_NUM) {
+        return bucket;
+    }
+    uint64_t shift = bucket / SUB_BUCKET_NUM - 1;
+    return (SUB_BUCKET_NUM + bucket % SUB_BUCKET_NUM) << shift;
+}
+
+uint64_t Metrics::Histogram::BucketHigh(size_t bucket)
+{
+    if (bucket < SUB_BUCKET_NUM) {
+        return bucket;
+    }
+    uint64_t shift = bucket / SUB_BUCKET_NUM - 1;
+    return BucketLow(bucket) + ((1ULL << shift) - 1);
+}
+
+void Metrics::Histogram::Record(uint64_t value)
+{
+    auto& shard = _shards[ShardIndex()];
+    shard.buckets[BucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+    shard.sum.fetch_add(value, std::memory_order_relaxed);
+    shard.count.fetch_add(1, std::memory_order_relaxed);
+    uint64_t max = shard.max.load(std::memory_order_relaxed);
+    while ((value > max) && !shard.max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+    }
+}
+
+Metrics::Histogram::Snapshot Metrics::Histogram::Get() const
+{
+    // shards are read one after another while being updated, so count and buckets may differ by a few
+    Snapshot snapshot;
+    snapshot.buckets.assign(BUCKET_NUM, 0);
+    for (size_t i = 0; i < SHARD_NUM; i++) {
+        const auto& shard = _shards[i];
+        snapshot.count += shard.count.load(std::memory_order_relaxed);
+        snapshot.sum += shard.sum.load(std::memory_order_relaxed);
+        snapshot.max = std::max(snapshot.max, shard.max.load(std::memory_order_relaxed));
+        for (size_t bucket = 0; bucket < BUCKET_NUM; bucket++) {
+            snapshot.buckets[bucket] += shard.buckets[bucket].load(std::memory_order_relaxed);
+        }
+    }
+    return snapshot;
+}
+
+uint64_t Metrics::Histogram::Snapshot::Percentile(double q) const
+{
+    uint64_t total = 0;
+    for (auto num : buckets) {
+        total += num;
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    auto rank = static_cast<uint64_t>(std::ceil(std::clamp(q, 0.0, 1.0) * static_cast<double>(total)));
+    rank = std::max<uint64_t>(rank, 1);
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < buckets.size(); bucket++) {
+        seen += buckets[bucket];
+        if (seen >= rank) {
+            return std::min(BucketHigh(bucket), max);
+        }
+    }
+    return max;
+}
+
+Metrics::Registry& Metrics::GetRegistry()
+{
+    // never destroyed, metrics may still be updated in destructors of other statics
+    static Registry* registry = new Registry();
+    return *registry;
+}
+
+Metrics::Counter& Metrics::GetCounter(const std::string& name)
+{
+    auto& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock {registry.lock};
+    auto& counter = registry.counters[name];
+    if (counter == nullptr) {
+        counter = std::make_unique<Counter>();
+    }
+    return *counter;
+}
+
+Metrics::Gauge& Metrics::GetGauge(const std::string& name)
+{
+    auto& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock {registry.lock};
+    auto& gauge = registry.gauges[name];
+    if (gauge == nullptr) {
+        gauge = std::make_unique<Gauge>();
+    }
+    return *gauge;
+}
+
+Metrics::Histogram& Metrics::GetHistogram(const std::string& name)
+{
+    auto& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock {registry.lock};
+    auto& histogram = registry.histograms[name];
+    if (histogram == nullptr) {
+        histogram = std::make_unique<Histogram>();
+    }
+    return *histogram;
+}
+
+void Metrics::Dump(std::ostream& out, Format format)
+{
+    auto& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock {registry.lock};
+    bool json = (format == Format::JSON);
+    const char* sep = "\n";
+    if (json) {
+        out << "{\"counters\":{";
+    }
+    for (const auto& [name, counter] : registry.counters) {
+        if (json) {
+            out << sep << "\"" << EscapeJson(name) << "\":" << counter->Get();
+            sep = ",\n";
+        } else {
+            out << "counter " << name << " " << counter->Get() << "\n";
+        }
+    }
+
+    sep = "\n";
+    if (json) {
+        out << "},\n\"gauges\":{";
+    }
+    for (const auto& [name, gauge] : registry.gauges) {
+        if (json) {
+            out << sep << "\"" << EscapeJson(name) << "\":" << gauge->Get();
+            sep = ",\n";
+        } else {
+            out << "gauge " << name << " " << gauge->Get() << "\n";
+        }
+    }
+
+    sep = "\n";
+    if (json) {
+        out << "},\n\"histograms\":{";
+    }
+    for (const auto& [name, histogram] : registry.histograms) {
+        auto snapshot = histogram->Get();
+        if (json) {
+            out << sep << "\"" << EscapeJson(name) << "\":{\"count\":" << snapshot.count << ",\"sum\":" << snapshot.sum
+                << ",\"max\":" << snapshot.max;
+            for (const auto& [q, qName] : EXPORTED_PERCENTILES) {
+                out << ",\"" << qName << "\":" << snapshot.Percentile(q);
+            }
+            out << "}";
+            sep = ",\n";
+        } else {
+            out << "histogram " << name << " count=" << snapshot.count << " sum=" << snapshot.sum
+                << " max=" << snapshot.max;
+            for (const auto& [q, qName] : EXPORTED_PERCENTILES) {
+                out << " " << qName << "=" << snapshot.Percentile(q);
+            }
+            out << "\n";
+        }
+    }
+    if (json) {
+        out << "}}\n";
+    }
+}
+
+bool Metrics::DumpToFile(const std::string& file, Format format)
+{
+    std::string tmpFile = file + ".tmp";
+    {
+        std::ofstream out(tmpFile, std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+        Dump(out, format);
+        out.flush();
+        if (!out) {
+            return false;
+        }
+    }
+    return std::rename(tmpFile.c_str(), file.c_str()) == 0;
+}
+
+MetricsExporter::MetricsExporter(std::string file, std::chrono::milliseconds interval, Metrics::Format format) :
+    _file(std::move(file)), _interval(interval), _format(format)
+{
+    _exporter = std::thread(&MetricsExporter::ExportLoop, this);
+}
+
+MetricsExporter::~MetricsExporter()
+{
+    {
+        std::lock_guard<std::mutex> lock {_lock};
+        _stopped = true;
+        _cv.notify_one();
+    }
+    if (_exporter.joinable()) {
+        _exporter.join();
+    }
+}
+
+void MetricsExporter::ExportLoop()
+{
+    std::unique_lock<std::mutex> lock {_lock};
+    bool failed = false;
+    while (true) {
+        bool stopped = _cv.wait_for(lock, _interval, [this]() { return _stopped; });
+        lock.unlock();
+        if (Metrics::DumpToFile(_file, _format)) {
+            _exported.fetch_add(1, std::memory_order_relaxed);
+            failed = false;
+        } else if (!failed) {
+            // reported once until an export succeeds again, the file may stay unwritable for a long time
+            PRINT_ERROR("can not export metrics to %s", _file.c_str());
+            failed = true;
+        }
+        lock.lock();
+        if (stopped) {
+            return;
+        }
+    }
+}
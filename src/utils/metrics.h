@@ -0,0 +1,194 @@
+#ifndef SMALL_DEMOS_METRICS_H
+#define SMALL_DEMOS_METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * process wide named metrics. a metric is created on its first use and lives as long as the process, so a
+ * call site can keep the reference it got, e.g. static auto& opened = Metrics::GetCounter("vfd.opened").
+ * updates go to the shard of the calling thread and never lock, reading sums up all shards.
+ */
+class Metrics {
+public:
+    static constexpr size_t SHARD_NUM = 16;
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+    class Counter {
+    public:
+        void Add(int64_t delta)
+        {
+            _shards[ShardIndex()].value.fetch_add(delta, std::memory_order_relaxed);
+        }
+
+        int64_t Get() const;
+
+    private:
+        struct alignas(CACHE_LINE_SIZE) Shard {
+            std::atomic<int64_t> value {0};
+        };
+
+        std::array<Shard, SHARD_NUM> _shards;
+    };
+
+    // a value which goes up and down, it is set as a whole so it is not sharded
+    class Gauge {
+    public:
+        void Set(int64_t value)
+        {
+            _value.store(value, std::memory_order_relaxed);
+        }
+
+        void Add(int64_t delta)
+        {
+            _value.fetch_add(delta, std::memory_order_relaxed);
+        }
+
+        int64_t Get() const
+        {
+            return _value.load(std::memory_order_relaxed);
+        }
+
+    private:
+        std::atomic<int64_t> _value {0};
+    };
+
+    /**
+     * HDR-style histogram of non-negative values, usually latencies in ns. values below SUB_BUCKET_NUM have a
+     * bucket each, above that every power of 2 is split into SUB_BUCKET_NUM buckets, so a percentile is at
+     * most 1 / SUB_BUCKET_NUM above the real one, whatever the magnitude.
+     */
+    class Histogram {
+    public:
+        static constexpr uint32_t SUB_BUCKET_BITS = 4;
+        static constexpr uint64_t SUB_BUCKET_NUM = 1ULL << SUB_BUCKET_BITS;
+        static constexpr size_t BUCKET_NUM = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_NUM;
+
+        struct Snapshot {
+            uint64_t count {0};
+            uint64_t sum {0};
+            uint64_t max {0};
+            std::vector<uint64_t> buckets;
+
+            // highest value of the bucket the q-th value falls in, q in [0, 1]
+            uint64_t Percentile(double q) const;
+        };
+
+        Histogram() : _shards(std::make_unique<Shard[]>(SHARD_NUM))
+        {}
+
+        void Record(uint64_t value);
+        Snapshot Get() const;
+
+        static size_t BucketOf(uint64_t value);
+        static uint64_t BucketLow(size_t bucket);
+        static uint64_t BucketHigh(size_t bucket);
+
+    private:
+        struct alignas(CACHE_LINE_SIZE) Shard {
+            std::atomic<uint64_t> count {0};
+            std::atomic<uint64_t> sum {0};
+            std::atomic<uint64_t> max {0};
+            std::array<std::atomic<uint64_t>, BUCKET_NUM> buckets {};
+        };
+
+        std::unique_ptr<Shard[]> _shards;
+    };
+
+    // records the time from its construction to its destruction into a histogram, in ns
+    class ScopedLatency {
+    public:
+        explicit ScopedLatency(Histogram& histogram) : _histogram(histogram), _start(std::chrono::steady_clock::now())
+        {}
+
+        ~ScopedLatency()
+        {
+            auto cost = std::chrono::steady_clock::now() - _start;
+            _histogram.Record(
+                static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(cost).count()));
+        }
+
+        ScopedLatency(const ScopedLatency&) = delete;
+        ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+    private:
+        Histogram& _histogram;
+        std::chrono::steady_clock::time_point _start;
+    };
+
+    enum class Format
+    {
+        TEXT,  // one "<type> <name> <values>" line per metric
+        JSON,
+    };
+
+    // counters, gauges and histograms have names of their own, one name may be used by each of them
+    static Counter& GetCounter(const std::string& name);
+    static Gauge& GetGauge(const std::string& name);
+    static Histogram& GetHistogram(const std::string& name);
+
+    // snapshot of all metrics, sorted by name
+    static void Dump(std::ostream& out, Format format);
+    // the snapshot replaces the file at once, a reader never sees half of it
+    static bool DumpToFile(const std::string& file, Format format);
+
+private:
+    struct Registry {
+        std::mutex lock;
+        std::map<std::string, std::unique_ptr<Counter>> counters;
+        std::map<std::string, std::unique_ptr<Gauge>> gauges;
+        std::map<std::string, std::unique_ptr<Histogram>> histograms;
+    };
+
+    static Registry& GetRegistry();
+
+    static size_t ShardIndex()
+    {
+        // threads take the shards in turn, more threads than shards share them
+        static std::atomic<size_t> nextShard {0};
+        static thread_local size_t shard = nextShard.fetch_add(1, std::memory_order_relaxed) % SHARD_NUM;
+        return shard;
+    }
+};
+
+// writes the snapshot of Metrics to a file every interval, and once more when it is destroyed
+class MetricsExporter {
+public:
+    MetricsExporter(std::string file, std::chrono::milliseconds interval, Metrics::Format format);
+    ~MetricsExporter();
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+    MetricsExporter(const MetricsExporter&&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&&) = delete;
+
+    uint64_t GetExported() const
+    {
+        return _exported.load(std::memory_order_relaxed);
+    }
+
+private:
+    void ExportLoop();
+
+    std::string _file;
+    std::chrono::milliseconds _interval;
+    Metrics::Format _format;
+    std::atomic<uint64_t> _exported {0};
+
+    std::mutex _lock;
+    std::condition_variable _cv;
+    bool _stopped {false};
+    std::thread _exporter;
+};
+
+#endif  // SMALL_DEMOS_METRICS_H
@@ -0,0 +1,130 @@
+#include "profiler.h"
+#include <algorithm>
+#include <fstream>
+#include <vector>
+#include "chrome_trace.h"
+
+Profiler::State& Profiler::GetState()
+{
+    // never destroyed, zones may still end in destructors of other statics
+    static State* state = new State();
+    return *state;
+}
+
+void Profiler::Start(size_t eventsPerThread)
+{
+    auto& state = GetState();
+    {
+        std::lock_guard<std::mutex> lock {state.lock};
+        state.capacity = eventsPerThread;
+        state.startTs.store(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - state.origin).count());
+    }
+    _on.store(1);
+}
+
+void Profiler::Stop()
+{
+    _on.store(0);
+}
+
+Profiler::ThreadBuffer* Profiler::LocalBuffer()
+{
+    // buffers are never freed, so the pointer of a thread stays valid for its whole life
+    static thread_local ThreadBuffer* cache = nullptr;
+    if (cache != nullptr) {
+        return cache;
+    }
+
+    // a buffer is kept after its thread exits, a thread reusing the id takes it over
+    auto& state = GetState();
+    std::lock_guard<std::mutex> lock {state.lock};
+    auto& buffer = state.buffers[std::this_thread::get_id()];
+    if (buffer == nullptr) {
+        buffer = std::make_unique<ThreadBuffer>(state.capacity, static_cast<uint32_t>(state.buffers.size()));
+    }
+
+    cache = buffer.get();
+    return cache;
+}
+
+void Profiler::Record(EventType type, const char* name, double value)
+{
+    auto ts = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - GetState().origin).count();
+    LocalBuffer()->ring.Push({name, ts, value, type});
+}
+
+void Profiler::Dump(std::ostream& out)
+{
+    struct Counter {
+        int64_t ts;
+        const char* name;
+        double delta;
+    };
+
+    auto& state = GetState();
+    std::vector<std::pair<uint32_t, std::vector<Event>>> threads;
+    {
+        std::lock_guard<std::mutex> lock {state.lock};
+        int64_t since = state.startTs.load();
+        for (const auto& [id, buffer] : state.buffers) {
+            threads.emplace_back(buffer->tid, std::vector<Event>());
+            auto& events = threads.back().second;
+            buffer->ring.Collect(events);
+            events.erase(events.begin(), std::find_if(events.begin(), events.end(),
+                                                      [since](const Event& event) { return event.ts >= since; }));
+        }
+    }
+    std::sort(threads.begin(), threads.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    using Writer = ChromeTraceWriter;
+    Writer trace(out);
+    std::vector<Counter> counters;
+    for (const auto& [tid, events] : threads) {
+        trace.ThreadName(tid, "thread " + std::to_string(tid));
+
+        // events of one thread are in order, so an end without a begin before it lost its begin
+        size_t depth = 0;
+        for (const auto& event : events) {
+            if (event.type == EventType::COUNT) {
+                counters.push_back({event.ts, event.name, event.value});
+                continue;
+            }
+            if (event.type == EventType::PLOT) {
+                trace.Next() << "{\"name\":\"" << Writer::Escape(event.name, "zone") << "\",\"ph\":\"C\",\"pid\":1"
+                             << ",\"tid\":" << tid << ",\"ts\":" << Writer::ToUs(event.ts)
+                             << ",\"args\":{\"value\":" << event.value << "}}";
+                continue;
+            }
+            if ((event.type == EventType::ZONE_END) && (depth == 0)) {
+                continue;
+            }
+            depth = (event.type == EventType::ZONE_BEGIN) ? (depth + 1) : (depth - 1);
+            trace.Next() << "{\"name\":\"" << Writer::Escape(event.name, "zone")
+                         << "\",\"cat\":\"zone\",\"ph\":\"" << ((event.type == EventType::ZONE_BEGIN) ? "B" : "E")
+                         << "\",\"pid\":1,\"tid\":" << tid << ",\"ts\":" << Writer::ToUs(event.ts) << "}";
+        }
+    }
+
+    // a counter is a track of the process, its running total is summed over all threads in time order
+    std::stable_sort(counters.begin(), counters.end(), [](const Counter& a, const Counter& b) { return a.ts < b.ts; });
+    std::unordered_map<std::string, double> totals;
+    for (const auto& counter : counters) {
+        std::string name = Writer::Escape(counter.name, "zone");
+        double& total = totals[name];
+        total += counter.delta;
+        trace.Next() << "{\"name\":\"" << name << "\",\"ph\":\"C\",\"pid\":1,\"ts\":"
+                     << Writer::ToUs(counter.ts) << ",\"args\":{\"value\":" << total << "}}";
+    }
+    trace.Finish();
+}
+
+bool Profiler::Dump(const std::string& file)
+{
+    std::ofstream out(file, std::ios::trunc);
+    if (!out) {
+        return false;
+    }
+    Dump(out);
+    out.flush();
+    return static_cast<bool>(out);
+}
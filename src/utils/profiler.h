@@ -0,0 +1,134 @@
+#ifndef SMALL_DEMOS_PROFILER_H
+#define SMALL_DEMOS_PROFILER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include "trace_ring.h"
+
+/**
+ * process wide timing of hot paths: zones (scopes with a start and an end), plots (a value over time) and
+ * counters (a running total of deltas). events go to a TraceRing of the recording thread which keeps the
+ * latest eventsPerThread ones, and are exported as Chrome trace-event json by ChromeTraceWriter.
+ * nothing is recorded until Start, a disabled zone costs one relaxed load.
+ * define SMALL_DEMOS_NO_PROFILE to compile all the macros out.
+ */
+class Profiler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class EventType : uint32_t
+    {
+        ZONE_BEGIN,
+        ZONE_END,
+        PLOT,
+        COUNT,
+    };
+
+    static void Start(size_t eventsPerThread);
+    static void Stop();
+
+    static bool IsOn()
+    {
+        return _on.load(std::memory_order_relaxed) != 0;
+    }
+
+    // name should be a string literal, or live as long as the process
+    static void Record(EventType type, const char* name, double value);
+
+    /**
+     * events since the latest Start, as far as the buffers still keep them. a zone whose begin is gone is
+     * left out, and counters are summed from the deltas which are left.
+     */
+    static void Dump(std::ostream& out);
+    static bool Dump(const std::string& file);
+
+private:
+    static constexpr size_t DEFAULT_EVENTS_PER_THREAD = 4096;
+
+    struct Event {
+        const char* name;
+        int64_t ts;
+        double value;
+        EventType type;
+    };
+
+    struct ThreadBuffer {
+        ThreadBuffer(size_t capacity, uint32_t threadId) : ring(capacity), tid(threadId)
+        {}
+
+        TraceRing<Event> ring;
+        uint32_t tid;
+    };
+
+    struct State {
+        std::mutex lock;
+        // capacity of the buffers created from now on, the ones already there keep theirs
+        size_t capacity {DEFAULT_EVENTS_PER_THREAD};
+        Clock::time_point origin {Clock::now()};
+        std::atomic<int64_t> startTs {0};
+        std::unordered_map<std::thread::id, std::unique_ptr<ThreadBuffer>> buffers;
+    };
+
+    static State& GetState();
+    static ThreadBuffer* LocalBuffer();
+
+    static inline std::atomic<uint32_t> _on {0};
+};
+
+// records the end of the zone when it goes out of scope
+class ProfileZone {
+public:
+    explicit ProfileZone(const char* name) : _name(Profiler::IsOn() ? name : nullptr)
+    {
+        if (_name != nullptr) {
+            Profiler::Record(Profiler::EventType::ZONE_BEGIN, _name, 0.0);
+        }
+    }
+
+    // a zone started before Stop still ends, so begins and ends stay paired
+    ~ProfileZone()
+    {
+        if (_name != nullptr) {
+            Profiler::Record(Profiler::EventType::ZONE_END, _name, 0.0);
+        }
+    }
+
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+    const char* _name;
+};
+
+#ifdef SMALL_DEMOS_NO_PROFILE
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_FUNCTION() ((void)0)
+#define PROFILE_PLOT(name, value) ((void)0)
+#define PROFILE_COUNT(name, delta) ((void)0)
+#else
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_ZONE(__func__)
+#define PROFILE_PLOT(name, value)                                                            \
+    do {                                                                                     \
+        if (Profiler::IsOn()) {                                                              \
+            Profiler::Record(Profiler::EventType::PLOT, name, static_cast<double>(value));  \
+        }                                                                                    \
+    } while (0)
+#define PROFILE_COUNT(name, delta)                                                           \
+    do {                                                                                     \
+        if (Profiler::IsOn()) {                                                              \
+            Profiler::Record(Profiler::EventType::COUNT, name, static_cast<double>(delta));  \
+        }                                                                                    \
+    } while (0)
+#endif
+
+#endif  // SMALL_DEMOS_PROFILER_H
@@ -0,0 +1,98 @@
+#ifndef SMALL_DEMOS_TRACE_RING_H
+#define SMALL_DEMOS_TRACE_RING_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+/**
+ * ring buffer of trace events written by one thread and read by any other, it keeps the latest capacity events.
+ * pushing takes no lock and never allocates. a reader never waits for the writer either, it drops the events
+ * which were overwritten while it was reading them.
+ * an event is stored as words of relaxed atomics, so a torn read is only dropped, never a data race.
+ */
+template<typename T>
+class TraceRing {
+public:
+    static_assert(std::is_trivially_copyable_v<T>, "events are copied word by word");
+
+    // capacity is rounded up to power of 2, so the slot of an event can be got by mask
+    explicit TraceRing(size_t capacity)
+    {
+        // utils is built as C++17 by the demos too, so no std::bit_ceil
+        _capacity = 2;
+        while (_capacity < capacity) {
+            _capacity <<= 1;
+        }
+        _slots = std::make_unique<Slot[]>(_capacity);
+    }
+
+    TraceRing(const TraceRing&) = delete;
+    TraceRing& operator=(const TraceRing&) = delete;
+    TraceRing(const TraceRing&&) = delete;
+    TraceRing& operator=(const TraceRing&&) = delete;
+
+    // owner thread only
+    void Push(const T& event)
+    {
+        uint64_t words[WORD_NUM] {};
+        std::memcpy(words, &event, sizeof(T));
+        uint64_t pos = _written.load(std::memory_order_relaxed);
+        auto& slot = _slots[pos & (_capacity - 1)];
+        // as in a seqlock: the words may not be seen before the _written of the previous push, so a reader which
+        // sees a word of this event also sees the event it overwrites counted as gone, see Collect
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < WORD_NUM; i++) {
+            slot.words[i].store(words[i], std::memory_order_relaxed);
+        }
+        _written.store(pos + 1, std::memory_order_release);
+    }
+
+    // any thread: appends the events still kept to out, oldest first
+    void Collect(std::vector<T>& out) const
+    {
+        uint64_t end = _written.load(std::memory_order_acquire);
+        uint64_t begin = (end > _capacity) ? (end - _capacity) : 0;
+        size_t first = out.size();
+        for (uint64_t pos = begin; pos < end; pos++) {
+            const auto& slot = _slots[pos & (_capacity - 1)];
+            uint64_t words[WORD_NUM];
+            for (size_t i = 0; i < WORD_NUM; i++) {
+                words[i] = slot.words[i].load(std::memory_order_relaxed);
+            }
+            std::memcpy(&out.emplace_back(), words, sizeof(T));
+        }
+
+        // the owner may have overwritten the oldest ones while they were being read, drop them.
+        // the event at newEnd may be half written, so its slot counts as overwritten too
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t newEnd = _written.load(std::memory_order_relaxed) + 1;
+        uint64_t overwritten = (newEnd > begin + _capacity) ? (newEnd - begin - _capacity) : 0;
+        overwritten = std::min<uint64_t>(overwritten, end - begin);
+        out.erase(out.begin() + static_cast<ptrdiff_t>(first),
+                  out.begin() + static_cast<ptrdiff_t>(first + overwritten));
+    }
+
+    size_t Capacity() const
+    {
+        return _capacity;
+    }
+
+private:
+    static constexpr size_t WORD_NUM = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    struct Slot {
+        std::atomic<uint64_t> words[WORD_NUM] {};
+    };
+
+    size_t _capacity;
+    std::unique_ptr<Slot[]> _slots;
+    std::atomic<uint64_t> _written {0};
+};
+
+#endif  // SMALL_DEMOS_TRACE_RING_H
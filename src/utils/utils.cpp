@@ -0,0 +1,48 @@
+#include "utils.h"
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+const char* LogLevelName(int level)
+{
+    switch (level) {
+        case LOG_LEVEL_DEBUG:
+            return "DEBUG";
+        case LOG_LEVEL_INFO:
+            return "INFO";
+        case LOG_LEVEL_ERROR:
+            return "ERROR";
+        default:
+            return "?";
+    }
+}
+
+void PrintLog(int level, const char* file, int line, const char* fmt, ...)
+{
+    // formatted on the stack, longer records are cut
+    constexpr size_t MAX_RECORD_SIZE = 1024;
+    char record[MAX_RECORD_SIZE];
+    const char* name = strrchr(file, '/');
+    int len = snprintf(record, sizeof(record), "[%s][%s:%d] ", LogLevelName(level),
+                       (name == nullptr) ? file : name + 1, line);
+    if ((len < 0) || (static_cast<size_t>(len) >= sizeof(record))) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, fmt);
+    int msgLen = vsnprintf(record + len, sizeof(record) - len, fmt, args);
+    va_end(args);
+    if (msgLen < 0) {
+        return;
+    }
+
+    size_t size = std::min(static_cast<size_t>(len + msgLen), sizeof(record) - 1);
+    // one newline per record, whether fmt has one or not
+    if ((size > 0) && (record[size - 1] == '\n')) {
+        size--;
+    }
+    record[size++] = '\n';
+    AsyncLogger::Default().Write(record, size);
+}
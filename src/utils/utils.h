@@ -0,0 +1,52 @@
+#ifndef SMALL_DEMOS_UTILS_H
+#define SMALL_DEMOS_UTILS_H
+
+#include "async_logger.h"
+#include "binary_log.h"
+
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_ERROR 2
+
+// levels below it are removed at compile time, their arguments are not even evaluated
+#ifndef SMALL_DEMOS_LOG_LEVEL
+#define SMALL_DEMOS_LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+/**
+ * printf style logging through AsyncLogger::Default(), a trailing newline of fmt is optional.
+ * with SMALL_DEMOS_LOG_BINARY defined, a call only saves the id of its call site and the raw arguments,
+ * and the formatting is deferred to the flusher or to log_decoder, see BinaryLog. fmt must be a literal then.
+ */
+#ifdef SMALL_DEMOS_LOG_BINARY
+#define SMALL_DEMOS_LOG(level, fmt, ...)                                                             \
+    do {                                                                                            \
+        static const uint32_t logSiteId = BinaryLog::RegisterSite({level, __FILE__, __LINE__, fmt}); \
+        BinaryLog::Write(logSiteId, ##__VA_ARGS__);                                                 \
+    } while (0)
+#else
+#define SMALL_DEMOS_LOG(level, fmt, ...) PrintLog(level, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+#endif
+
+#if SMALL_DEMOS_LOG_LEVEL <= LOG_LEVEL_DEBUG
+#define PRINT_DEBUG(fmt, ...) SMALL_DEMOS_LOG(LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#else
+#define PRINT_DEBUG(fmt, ...) ((void)0)
+#endif
+
+#if SMALL_DEMOS_LOG_LEVEL <= LOG_LEVEL_INFO
+#define PRINT_INFO(fmt, ...) SMALL_DEMOS_LOG(LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#else
+#define PRINT_INFO(fmt, ...) ((void)0)
+#endif
+
+#if SMALL_DEMOS_LOG_LEVEL <= LOG_LEVEL_ERROR
+#define PRINT_ERROR(fmt, ...) SMALL_DEMOS_LOG(LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#else
+#define PRINT_ERROR(fmt, ...) ((void)0)
+#endif
+
+const char* LogLevelName(int level);
+void PrintLog(int level, const char* file, int line, const char* fmt, ...);
+
+#endif  // SMALL_DEMOS_UTILS_H
@@ -0,0 +1,140 @@
+#include "async_thread/async_scope.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include "async_thread/async_task.h"
+#include "worker_gate.h"
+
+TEST(async_scope_test, join_waits_for_spawned_work)
+{
+    constexpr int TASK_NUM = 100;
+    // the queue holds all of them, so none is refused
+    ThreadPool executor(4, TASK_NUM);
+    executor.Init();
+    std::atomic<int> done {0};
+    {
+        AsyncScope scope;
+        for (int i = 0; i < TASK_NUM; i++) {
+            EXPECT_TRUE(scope.Spawn(executor, [&done]() {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                done++;
+            }));
+        }
+    }
+    EXPECT_EQ(done.load(), TASK_NUM);
+    executor.Destroy();
+}
+
+TEST(async_scope_test, cancel_skips_work_not_started)
+{
+    ThreadPool executor(1, 10);
+    executor.Init();
+    WorkerGate gate(executor);
+
+    std::atomic<int> done {0};
+    AsyncScope scope;
+    for (int i = 0; i < 5; i++) {
+        scope.Spawn(executor, [&done]() { done++; });
+    }
+    scope.Cancel();
+    gate.Open();
+    scope.Join();
+    EXPECT_EQ(done.load(), 0);
+    executor.Destroy();
+}
+
+TEST(async_scope_test, join_waits_for_suspended_coroutine)
+{
+    auto [sender, receiver] = MakeOneShot<int>();
+    int got = 0;
+    auto flow = [](OneShotReceiver<int> input, int& got) -> Task<void> { got = *co_await std::move(input); };
+
+    AsyncScope scope;
+    scope.Spawn(flow(std::move(receiver), got));
+    std::thread producer([sender = std::move(sender)]() mutable {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        (void)sender.Send(5);
+    });
+    scope.Join();
+    EXPECT_EQ(got, 5);
+    producer.join();
+}
+
+TEST(async_scope_test, cancel_resumes_coroutine_awaiting_skipped_work)
+{
+    ThreadPool executor(1, 10);
+    executor.Init();
+    WorkerGate gate(executor);
+
+    AsyncTask taskObj(executor);
+    bool resumed = false;
+    auto flow = [](AsyncTask& taskObj, CancellationToken token, bool& resumed) -> Task<void> {
+        auto content = co_await taskObj.Start(token);
+        EXPECT_FALSE(content.has_value());
+        resumed = true;
+    };
+
+    AsyncScope scope;
+    scope.Spawn(flow(taskObj, scope.GetToken(), resumed));
+    scope.Cancel();
+    gate.Open();
+    // the producer is skipped, the coroutine goes on with nothing and leaves the scope
+    scope.Join();
+    EXPECT_TRUE(resumed);
+    executor.Destroy();
+}
+
+TEST(async_scope_test, dropped_work_leaves_scope)
+{
+    AsyncScope scope;
+    {
+        auto [sender, receiver] = MakeOneShot<int>();
+        receiver.Then([ticket = scope.GetTicket()](int&) { FAIL(); });
+    }
+    // the channel is gone with the ticket in its callback, nothing is left to wait for
+    scope.Join();
+}
+
+TEST(async_scope_test, async_task_callback_done_at_scope_end)
+{
+    ThreadPool executor(2, 20);
+    executor.Init();
+    AsyncTask taskObj(executor);
+    std::atomic<int> done {0};
+    {
+        AsyncScope scope;
+        for (int i = 0; i < 20; i++) {
+            taskObj.StartTask(scope, [&done](AsyncTask::TaskContent& content) { done += content.id; });
+        }
+    }
+    EXPECT_EQ(done.load(), 20);
+    executor.Destroy();
+}
+
+TEST(async_scope_test, coroutine_left_in_stopped_pool_leaves_scope)
+{
+    // the queue never fills up below, a refused task means the pool has stopped
+    ThreadPool executor(1, 10000);
+    executor.Init();
+    // the only worker is held until the pool has stopped, so the coroutine is never resumed by it
+    executor.AddTask([&executor]() {
+        while (executor.AddTask([]() {}).valid()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+
+    std::atomic<int> onPool {-1};
+    auto flow = [](ThreadPool& executor, std::atomic<int>& onPool) -> Task<void> {
+        ScheduleOn hop(executor);
+        onPool = co_await hop ? 1 : 0;
+    };
+
+    AsyncScope scope;
+    scope.Spawn(flow(executor, onPool));
+    executor.Destroy();
+    // the pool drops the task, which goes on with the coroutine, and the scope has nothing left to wait for
+    scope.Join();
+    EXPECT_EQ(onPool.load(), 0);
+}
@@ -0,0 +1,130 @@
+#include "async_thread/async_stream.h"
+#include <gtest/gtest.h>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+#include "async_thread/async_scope.h"
+#include "async_thread/async_task.h"
+
+namespace {
+Task<void> Produce(AsyncStream<int>& stream, int num, int& pushed)
+{
+    for (int i = 0; i < num; i++) {
+        if (!co_await stream.Push(i)) {
+            co_return;
+        }
+        pushed++;
+    }
+    stream.Close();
+}
+
+Task<void> Consume(AsyncStream<int>& stream, std::vector<int>& got)
+{
+    while (auto item = co_await stream.Next()) {
+        got.push_back(*item);
+    }
+}
+
+Task<int> NextItem(AsyncStream<int>& stream)
+{
+    auto item = co_await stream.Next();
+    co_return item.value_or(-1);
+}
+
+Task<bool> PushOne(AsyncStream<std::unique_ptr<int>>& stream, int value)
+{
+    auto item = std::make_unique<int>(value);
+    co_return co_await stream.Push(std::move(item));
+}
+
+Task<void> CollectNames(AsyncStream<AsyncTask::TaskContent>& stream, std::promise<std::vector<std::string>>& names)
+{
+    std::vector<std::string> got;
+    while (auto content = co_await stream.Next()) {
+        got.push_back(std::move(content->name));
+    }
+    names.set_value(std::move(got));
+}
+}  // namespace
+
+TEST(async_stream_test, producer_waits_while_buffer_is_full)
+{
+    AsyncStream<int> stream(2);
+    int pushed = 0;
+    AsyncScope scope;
+    scope.Spawn(Produce(stream, 5, pushed));
+    // the producer fills the buffer and waits for room
+    EXPECT_EQ(pushed, 2);
+
+    std::vector<int> got;
+    int item = -1;
+    Launch(NextItem(stream)).Then([&item](int& value) { item = value; });
+    EXPECT_EQ(item, 0);
+    // the room is taken by the waiting producer at once, and it goes on until the buffer is full again
+    EXPECT_EQ(pushed, 3);
+
+    scope.Spawn(Consume(stream, got));
+    scope.Join();
+    EXPECT_EQ(pushed, 5);
+    EXPECT_EQ(got, std::vector<int>({1, 2, 3, 4}));
+}
+
+TEST(async_stream_test, consumer_waits_for_items)
+{
+    AsyncStream<int> stream(4);
+    std::vector<int> got;
+    AsyncScope scope;
+    scope.Spawn(Consume(stream, got));
+    EXPECT_TRUE(got.empty());
+
+    int pushed = 0;
+    scope.Spawn(Produce(stream, 3, pushed));
+    scope.Join();
+    EXPECT_EQ(got, std::vector<int>({0, 1, 2}));
+}
+
+TEST(async_stream_test, consumer_close_stops_producer)
+{
+    AsyncStream<int> stream(1);
+    int pushed = 0;
+    AsyncScope scope;
+    scope.Spawn(Produce(stream, 100, pushed));
+    EXPECT_EQ(pushed, 1);
+    stream.Close();
+    scope.Join();
+    EXPECT_EQ(pushed, 1);
+}
+
+TEST(async_stream_test, items_are_moved)
+{
+    AsyncStream<std::unique_ptr<int>> stream(1);
+    bool accepted = false;
+    Launch(PushOne(stream, 7)).Then([&accepted](bool& value) { accepted = value; });
+    EXPECT_TRUE(accepted);
+
+    auto next = stream.Next();
+    EXPECT_FALSE(next.await_suspend(std::noop_coroutine()));
+    auto item = next.await_resume();
+    ASSERT_TRUE(item.has_value());
+    EXPECT_EQ(**item, 7);
+}
+
+TEST(async_stream_test, async_task_scan_streams_results)
+{
+    ThreadPool executor(2, 10);
+    executor.Init();
+    AsyncTask task(executor);
+    AsyncStream<AsyncTask::TaskContent> stream(3);
+    std::promise<std::vector<std::string>> names;
+    {
+        AsyncScope scope;
+        scope.Spawn(task.Scan(stream, 20));
+        scope.Spawn(CollectNames(stream, names));
+    }
+    auto got = names.get_future().get();
+    ASSERT_EQ(got.size(), 20U);
+    EXPECT_EQ(got.front(), "id 1");
+    EXPECT_EQ(got.back(), "id 20");
+    executor.Destroy();
+}
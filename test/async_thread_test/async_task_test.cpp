@@ -0,0 +1,86 @@
+#include "async_thread/async_task.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <filesystem>
+#include <future>
+#include <thread>
+#include "worker_gate.h"
+
+namespace {
+size_t ThreadNum()
+{
+    auto tasks = std::filesystem::directory_iterator("/proc/self/task");
+    return static_cast<size_t>(std::distance(std::filesystem::begin(tasks), std::filesystem::end(tasks)));
+}
+}  // namespace
+
+TEST(async_task_test, callback_runs_on_executor)
+{
+    ThreadPool executor(1, 10);
+    executor.Init();
+    AsyncTask task(executor);
+    // the only worker is held until the callback is set, so the callback is run by the producer
+    WorkerGate gate(executor);
+
+    std::promise<std::thread::id> called;
+    task.StartTask([&called](AsyncTask::TaskContent& result) {
+        EXPECT_EQ(result.id, 1);
+        EXPECT_EQ(result.name, "id 1");
+        called.set_value(std::this_thread::get_id());
+    });
+    gate.Open();
+    auto callbackThread = called.get_future().get();
+    EXPECT_NE(callbackThread, std::this_thread::get_id());
+    executor.Destroy();
+}
+
+TEST(async_task_test, no_thread_started_per_task)
+{
+    constexpr int TASK_NUM = 1000;
+    constexpr uint32_t POOL_SIZE = 4;
+    // the queue holds all of them, so none is refused and run by the caller
+    ThreadPool executor(POOL_SIZE, TASK_NUM + POOL_SIZE);
+    executor.Init();
+    AsyncTask task(executor);
+    size_t threadNum = ThreadNum();
+
+    // every worker is held until all tasks are started, so no result is there before its callback is set
+    WorkerGate gate(executor, POOL_SIZE);
+    ASSERT_TRUE(gate.IsHolding());
+
+    auto caller = std::this_thread::get_id();
+    std::atomic<int> done {0};
+    std::atomic<int> onCaller {0};
+    std::promise<void> allDone;
+    for (int i = 0; i < TASK_NUM; i++) {
+        task.StartTask([&done, &onCaller, &allDone, caller](AsyncTask::TaskContent&) {
+            if (std::this_thread::get_id() == caller) {
+                onCaller.fetch_add(1);
+            }
+            if (done.fetch_add(1) + 1 == TASK_NUM) {
+                allDone.set_value();
+            }
+        });
+        EXPECT_LE(ThreadNum(), threadNum);
+    }
+    gate.Open();
+    allDone.get_future().wait();
+    EXPECT_EQ(onCaller.load(), 0);
+    executor.Destroy();
+}
+
+TEST(async_task_test, refused_task_closes_channel)
+{
+    ThreadPool executor(1, 1);
+    executor.Init();
+    executor.Destroy();
+    AsyncTask task(executor);
+
+    // nothing runs on the caller, the receiver sees the channel closed without a value
+    bool called = false;
+    task.StartTask([&called](AsyncTask::TaskContent&) { called = true; });
+    EXPECT_FALSE(called);
+    bool closed = false;
+    task.Start().ThenOrClosed([&closed](AsyncTask::TaskContent* content) { closed = (content == nullptr); });
+    EXPECT_TRUE(closed);
+}
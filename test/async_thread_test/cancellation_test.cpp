@@ -0,0 +1,141 @@
+#include "async_thread/cancellation.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+#include "async_thread/async_scope.h"
+#include "async_thread/async_task.h"
+#include "worker_gate.h"
+
+TEST(cancellation_test, default_token_is_never_cancelled)
+{
+    CancellationToken token;
+    EXPECT_FALSE(token.CanBeCancelled());
+    EXPECT_FALSE(token.IsCancelled());
+    int calls = 0;
+    auto registration = token.Register([&calls]() { calls++; });
+    EXPECT_EQ(calls, 0);
+}
+
+TEST(cancellation_test, callbacks_run_once_on_cancel)
+{
+    CancellationSource source;
+    auto token = source.GetToken();
+    int calls = 0;
+    auto first = token.Register([&calls]() { calls++; });
+    auto second = token.Register([&calls]() { calls++; });
+    EXPECT_FALSE(token.IsCancelled());
+
+    EXPECT_TRUE(source.Cancel());
+    EXPECT_FALSE(source.Cancel());
+    EXPECT_TRUE(token.IsCancelled());
+    EXPECT_EQ(calls, 2);
+
+    // registered after the cancellation, it runs at once
+    auto late = token.Register([&calls]() { calls++; });
+    EXPECT_EQ(calls, 3);
+}
+
+TEST(cancellation_test, unregistered_callback_does_not_run)
+{
+    CancellationSource source;
+    int calls = 0;
+    {
+        auto registration = source.GetToken().Register([&calls]() { calls++; });
+    }
+    source.Cancel();
+    EXPECT_EQ(calls, 0);
+}
+
+TEST(cancellation_test, unregister_waits_for_running_callback)
+{
+    CancellationSource source;
+    std::promise<void> started;
+    std::atomic<uint32_t> finished {0};
+    auto registration = std::make_unique<CancellationRegistration>(source.GetToken().Register([&]() {
+        started.set_value();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        finished.store(1);
+    }));
+
+    std::thread canceller([&source]() { source.Cancel(); });
+    started.get_future().wait();
+    registration.reset();
+    EXPECT_EQ(finished.load(), 1U);
+    canceller.join();
+}
+
+TEST(cancellation_test, linked_source_follows_parents)
+{
+    CancellationSource request;
+    CancellationSource client;
+    CancellationSource step(std::vector {request.GetToken(), client.GetToken()});
+    int aborted = 0;
+    auto registration = step.GetToken().Register([&aborted]() { aborted++; });
+
+    // a step can be cancelled alone
+    CancellationSource other(request.GetToken());
+    other.Cancel();
+    EXPECT_FALSE(step.IsCancelled());
+
+    client.Cancel();
+    EXPECT_TRUE(step.IsCancelled());
+    EXPECT_FALSE(request.IsCancelled());
+    EXPECT_EQ(aborted, 1);
+}
+
+TEST(cancellation_test, cancelled_async_task_skips_producer_and_callback)
+{
+    ThreadPool executor(1, 10);
+    executor.Init();
+    AsyncTask task(executor);
+    WorkerGate gate(executor);
+
+    CancellationSource source;
+    auto receiver = task.Start(source.GetToken());
+    int calls = 0;
+    task.StartTask([&calls](AsyncTask::TaskContent&) { calls++; }, source.GetToken());
+    source.Cancel();
+    gate.Open();
+
+    // the producers are skipped, so the channels are never sent
+    std::promise<void> drained;
+    executor.AddTask([&drained]() { drained.set_value(); });
+    drained.get_future().wait();
+    EXPECT_FALSE(receiver.Ready());
+    EXPECT_EQ(calls, 0);
+    executor.Destroy();
+}
+
+namespace {
+Task<void> ReadAndCancel(AsyncStream<AsyncTask::TaskContent>& stream, CancellationSource& source,
+                         std::promise<int>& read)
+{
+    int num = 0;
+    while (auto content = co_await stream.Next()) {
+        if (++num == 2) {
+            source.Cancel();
+        }
+    }
+    read.set_value(num);
+}
+}  // namespace
+
+TEST(cancellation_test, cancelled_scan_ends_stream)
+{
+    ThreadPool executor(1, 10);
+    executor.Init();
+    AsyncTask task(executor);
+    AsyncStream<AsyncTask::TaskContent> stream(1);
+    CancellationSource source;
+    std::promise<int> read;
+    {
+        AsyncScope scope;
+        scope.Spawn(task.Scan(stream, 1000, source.GetToken()));
+        scope.Spawn(ReadAndCancel(stream, source, read));
+    }
+    EXPECT_LT(read.get_future().get(), 10);
+    executor.Destroy();
+}
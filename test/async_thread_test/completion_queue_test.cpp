@@ -0,0 +1,103 @@
+#include "async_thread/completion_queue.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "async_thread/async_task.h"
+
+using namespace std::chrono_literals;
+
+TEST(completion_queue_test, poll_drains_in_order)
+{
+    CompletionQueue<int> queue;
+    std::vector<int> out;
+    EXPECT_EQ(queue.Poll(out), 0U);
+    for (int i = 0; i < 5; i++) {
+        queue.Post(i);
+    }
+    EXPECT_EQ(queue.Poll(out, 2), 2U);
+    EXPECT_EQ(queue.Poll(out), 3U);
+    EXPECT_EQ(out, std::vector<int>({0, 1, 2, 3, 4}));
+}
+
+TEST(completion_queue_test, wait_returns_what_arrived_by_timeout)
+{
+    CompletionQueue<std::unique_ptr<int>> queue;
+    queue.Post(std::make_unique<int>(1));
+    std::vector<std::unique_ptr<int>> out;
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(queue.Wait(out, 2, 20ms), 1U);
+    EXPECT_GE(std::chrono::steady_clock::now() - start, 20ms);
+    ASSERT_EQ(out.size(), 1U);
+    EXPECT_EQ(*out[0], 1);
+}
+
+TEST(completion_queue_test, wait_wakes_up_on_post)
+{
+    CompletionQueue<int> queue;
+    std::thread producer([&queue]() {
+        std::this_thread::sleep_for(10ms);
+        queue.Post(1);
+        queue.Post(2);
+    });
+    std::vector<int> out;
+    while (out.size() < 2) {
+        queue.Wait(out, 2 - out.size(), 10s);
+    }
+    producer.join();
+    EXPECT_EQ(out, std::vector<int>({1, 2}));
+}
+
+TEST(completion_queue_test, many_producers_one_owner)
+{
+    constexpr int PRODUCER_NUM = 4;
+    constexpr int POST_NUM = 10000;
+    CompletionQueue<int> queue;
+    std::vector<std::thread> producers;
+    for (int p = 0; p < PRODUCER_NUM; p++) {
+        producers.emplace_back([&queue, p]() {
+            for (int i = 0; i < POST_NUM; i++) {
+                queue.Post(p * POST_NUM + i);
+            }
+        });
+    }
+
+    std::vector<int> out;
+    while (out.size() < PRODUCER_NUM * POST_NUM) {
+        queue.Wait(out, 64, 1s);
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    // every producer's completions arrive in the order it posted them
+    std::vector<int> last(PRODUCER_NUM, -1);
+    for (int value : out) {
+        EXPECT_GT(value, last[value / POST_NUM]);
+        last[value / POST_NUM] = value;
+    }
+    EXPECT_EQ(out.size(), static_cast<size_t>(PRODUCER_NUM * POST_NUM));
+}
+
+TEST(completion_queue_test, async_task_posts_completions)
+{
+    ThreadPool executor(2, 10);
+    executor.Init();
+    AsyncTask task(executor);
+    CompletionQueue<Tagged<AsyncTask::TaskContent>> queue;
+    for (uint64_t tag = 0; tag < 3; tag++) {
+        task.StartTask(queue, tag);
+    }
+
+    std::vector<Tagged<AsyncTask::TaskContent>> out;
+    while (out.size() < 3) {
+        queue.Wait(out, 3 - out.size(), 10s);
+    }
+    uint64_t tags = 0;
+    for (const auto& completion : out) {
+        EXPECT_EQ(completion.value.id, 1);
+        tags |= 1ULL << completion.tag;
+    }
+    EXPECT_EQ(tags, 7U);
+    executor.Destroy();
+}
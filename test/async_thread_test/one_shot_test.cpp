@@ -0,0 +1,110 @@
+#include "async_thread/one_shot.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+TEST(one_shot_test, value_first_runs_callback_in_then)
+{
+    auto [sender, receiver] = MakeOneShot<std::string>();
+    EXPECT_TRUE(sender.Send("value"));
+    EXPECT_TRUE(receiver.Ready());
+
+    std::string got;
+    receiver.Then([&got](std::string& value) { got = std::move(value); });
+    EXPECT_EQ(got, "value");
+    EXPECT_FALSE(receiver);
+}
+
+TEST(one_shot_test, callback_first_runs_in_send)
+{
+    auto [sender, receiver] = MakeOneShot<int>();
+    std::thread::id callbackThread;
+    receiver.Then([&callbackThread](int& value) {
+        EXPECT_EQ(value, 7);
+        callbackThread = std::this_thread::get_id();
+    });
+    EXPECT_EQ(callbackThread, std::thread::id());
+
+    std::thread producer([sender = std::move(sender)]() mutable { EXPECT_TRUE(sender.Send(7)); });
+    auto producerThread = producer.get_id();
+    producer.join();
+    EXPECT_EQ(callbackThread, producerThread);
+}
+
+TEST(one_shot_test, copies_of_sender_send_once)
+{
+    auto [sender, receiver] = MakeOneShot<int>();
+    auto copy = sender;
+    int calls = 0;
+    receiver.Then([&calls](int& value) {
+        EXPECT_EQ(value, 1);
+        calls++;
+    });
+    EXPECT_TRUE(copy.Send(1));
+    EXPECT_FALSE(sender.Send(2));
+    EXPECT_EQ(calls, 1);
+}
+
+TEST(one_shot_test, unsent_channel_drops_callback)
+{
+    auto captured = std::make_shared<int>(0);
+    {
+        auto [sender, receiver] = MakeOneShot<int>();
+        receiver.Then([captured](int&) { (*captured)++; });
+        EXPECT_EQ(captured.use_count(), 2);
+    }
+    EXPECT_EQ(captured.use_count(), 1);
+    EXPECT_EQ(*captured, 0);
+}
+
+TEST(one_shot_test, released_state_is_reused)
+{
+    // a new state is referenced by both ends
+    auto state = OneShotState<int>::New();
+    state->Release();
+    state->Release();
+    auto reused = OneShotState<int>::New();
+    EXPECT_EQ(reused, state);
+    reused->Release();
+    reused->Release();
+}
+
+TEST(one_shot_test, state_released_on_other_thread_is_reused_by_allocating_thread)
+{
+    auto state = OneShotState<int>::New();
+    std::thread([state]() {
+        state->Release();
+        state->Release();
+    }).join();
+    auto reused = OneShotState<int>::New();
+    EXPECT_EQ(reused, state);
+
+    // the allocating thread is gone when the last end is released, the releasing thread frees the state
+    OneShotState<int>* orphan = nullptr;
+    std::thread([&orphan]() { orphan = OneShotState<int>::New(); }).join();
+    orphan->Release();
+    orphan->Release();
+
+    reused->Release();
+    reused->Release();
+}
+
+TEST(one_shot_test, racing_sides_run_callback_once)
+{
+    constexpr int ROUND_NUM = 2000;
+    std::atomic<int> calls {0};
+    std::atomic<int> sum {0};
+    for (int i = 0; i < ROUND_NUM; i++) {
+        auto [sender, receiver] = MakeOneShot<int>();
+        std::thread producer([&sender, i]() { (void)sender.Send(i); });
+        receiver.Then([&calls, &sum](int& value) {
+            calls++;
+            sum += value;
+        });
+        producer.join();
+    }
+    EXPECT_EQ(calls.load(), ROUND_NUM);
+    EXPECT_EQ(sum.load(), ROUND_NUM * (ROUND_NUM - 1) / 2);
+}
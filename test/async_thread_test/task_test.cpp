@@ -0,0 +1,122 @@
+#include "async_thread/task.h"
+#include <gtest/gtest.h>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include "async_thread/async_task.h"
+#include "worker_gate.h"
+
+namespace {
+Task<int> Identity(int value)
+{
+    co_return value;
+}
+
+Task<long> SumOfIdentities(int num)
+{
+    long sum = 0;
+    for (int i = 0; i < num; i++) {
+        sum += co_await Identity(i);
+    }
+    co_return sum;
+}
+
+Task<void> SetFlag(bool& flag)
+{
+    flag = true;
+    co_return;
+}
+
+Task<std::string> AwaitVoid(bool& flag)
+{
+    co_await SetFlag(flag);
+    co_return "done";
+}
+
+Task<int> Fail()
+{
+    throw std::runtime_error("failed");
+    co_return 0;
+}
+
+Task<std::string> CatchFailure()
+{
+    try {
+        co_await Fail();
+    } catch (const std::runtime_error& e) {
+        co_return e.what();
+    }
+    co_return "not thrown";
+}
+
+template<typename T>
+T WaitFor(OneShotReceiver<T> receiver)
+{
+    std::promise<T> result;
+    receiver.Then([&result](T& value) { result.set_value(std::move(value)); });
+    return result.get_future().get();
+}
+}  // namespace
+
+TEST(task_test, task_is_lazy)
+{
+    bool flag = false;
+    auto task = AwaitVoid(flag);
+    EXPECT_FALSE(flag);
+
+    auto receiver = Launch(std::move(task));
+    EXPECT_TRUE(flag);
+    EXPECT_EQ(WaitFor(std::move(receiver)), "done");
+}
+
+TEST(task_test, exception_is_rethrown_to_awaiting_coroutine)
+{
+    EXPECT_EQ(WaitFor(Launch(CatchFailure())), "failed");
+
+    // nobody awaits a launched task, what escapes from it closes the channel
+    auto receiver = Launch(Fail());
+    bool closed = false;
+    receiver.ThenOrClosed([&closed](int* value) { closed = (value == nullptr); });
+    EXPECT_TRUE(closed);
+}
+
+TEST(task_test, long_chain_of_sync_awaits_keeps_stack_flat)
+{
+    // every await finishes at once, without symmetric transfer each one would nest one more resume
+    constexpr int AWAIT_NUM = 1000000;
+    EXPECT_EQ(WaitFor(Launch(SumOfIdentities(AWAIT_NUM))), static_cast<long>(AWAIT_NUM) * (AWAIT_NUM - 1) / 2);
+}
+
+TEST(task_test, awaits_one_shot_from_other_thread)
+{
+    auto [sender, receiver] = MakeOneShot<int>();
+    auto flow = [](OneShotReceiver<int> input) -> Task<int> { co_return *(co_await std::move(input)) * 2; };
+    auto result = Launch(flow(std::move(receiver)));
+    EXPECT_FALSE(result.Ready());
+
+    std::thread producer([sender = std::move(sender)]() mutable { (void)sender.Send(21); });
+    producer.join();
+    EXPECT_TRUE(result.Ready());
+    EXPECT_EQ(WaitFor(std::move(result)), 42);
+}
+
+TEST(task_test, async_task_steps_run_on_executor)
+{
+    ThreadPool executor(1, 10);
+    executor.Init();
+    AsyncTask taskObj(executor);
+    // the only worker is held until the flow is suspended, a step done before that goes on on the caller
+    WorkerGate gate(executor);
+
+    auto flow = [](AsyncTask& taskObj, std::thread::id caller) -> Task<int> {
+        auto first = co_await taskObj.Fetch();
+        EXPECT_NE(std::this_thread::get_id(), caller);
+        auto second = co_await taskObj.Start();
+        co_return first->id + second->id;
+    };
+    auto result = Launch(flow(taskObj, std::this_thread::get_id()));
+    gate.Open();
+    EXPECT_EQ(WaitFor(std::move(result)), 2);
+    executor.Destroy();
+}
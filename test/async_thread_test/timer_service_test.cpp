@@ -0,0 +1,137 @@
+#include "async_thread/timer_service.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+Task<int> SleepThenSet(TimerService& timer, std::promise<std::thread::id>& resumedOn)
+{
+    co_await SleepFor(timer, 10ms);
+    resumedOn.set_value(std::this_thread::get_id());
+    co_return 0;
+}
+}  // namespace
+
+TEST(timer_service_test, timers_fire_in_deadline_order)
+{
+    TimerService timer;
+    std::mutex lock;
+    std::vector<int> fired;
+    std::promise<void> done;
+    auto now = TimerService::Clock::now();
+    timer.ScheduleAt(now + 30ms, [&]() {
+        std::lock_guard<std::mutex> guard {lock};
+        fired.push_back(3);
+        done.set_value();
+    });
+    timer.ScheduleAt(now + 10ms, [&]() {
+        std::lock_guard<std::mutex> guard {lock};
+        fired.push_back(1);
+    });
+    timer.ScheduleAt(now + 20ms, [&]() {
+        std::lock_guard<std::mutex> guard {lock};
+        fired.push_back(2);
+    });
+    done.get_future().wait();
+    std::lock_guard<std::mutex> guard {lock};
+    EXPECT_EQ(fired, std::vector<int>({1, 2, 3}));
+    EXPECT_GE(TimerService::Clock::now() - now, 30ms);
+}
+
+TEST(timer_service_test, cancelled_timer_does_not_fire)
+{
+    TimerService timer;
+    std::atomic<uint32_t> fired {0};
+    auto id = timer.ScheduleAfter(20ms, [&fired]() { fired.store(1); });
+    EXPECT_EQ(timer.GetPending(), 1U);
+    EXPECT_TRUE(timer.Cancel(id));
+    EXPECT_FALSE(timer.Cancel(id));
+    EXPECT_EQ(timer.GetPending(), 0U);
+    std::this_thread::sleep_for(40ms);
+    EXPECT_EQ(fired.load(), 0U);
+}
+
+TEST(timer_service_test, many_timers_share_one_thread)
+{
+    constexpr int num = 10000;
+    TimerService timer;
+    std::atomic<int> fired {0};
+    std::promise<void> done;
+    for (int i = 0; i < num; i++) {
+        timer.ScheduleAfter(std::chrono::microseconds(i), [&]() {
+            if (fired.fetch_add(1) + 1 == num) {
+                done.set_value();
+            }
+        });
+    }
+    done.get_future().wait();
+    EXPECT_EQ(timer.GetPending(), 0U);
+}
+
+TEST(timer_service_test, sleep_for_resumes_on_timer_thread)
+{
+    TimerService timer;
+    std::promise<std::thread::id> resumedOn;
+    auto future = resumedOn.get_future();
+    auto receiver = Launch(SleepThenSet(timer, resumedOn));
+    EXPECT_NE(future.get(), std::this_thread::get_id());
+}
+
+TEST(timer_service_test, sleeping_coroutine_is_resumed_when_timer_is_destroyed)
+{
+    auto flow = [](TimerService& timer) -> Task<int> {
+        int elapsed = co_await SleepFor(timer, 1h) ? 1 : 0;
+        // the timer is stopping, a later sleep does not wait either
+        elapsed += co_await SleepFor(timer, 1h) ? 10 : 0;
+        co_return elapsed;
+    };
+    std::optional<OneShotReceiver<int>> result;
+    {
+        TimerService timer;
+        result.emplace(Launch(flow(timer)));
+    }
+    // the coroutine has run to its end on this thread, nothing is left suspended
+    ASSERT_TRUE(result->Ready());
+    int elapsed = -1;
+    result->Then([&elapsed](int& value) { elapsed = value; });
+    EXPECT_EQ(elapsed, 0);
+}
+
+TEST(timer_service_test, value_before_deadline)
+{
+    TimerService timer;
+    auto [sender, receiver] = MakeOneShot<int>();
+    auto timed = WithTimeout(timer, std::move(receiver), TimerService::Clock::now() + 1s);
+    EXPECT_EQ(timer.GetPending(), 1U);
+    EXPECT_TRUE(sender.Send(5));
+
+    // the value cancels the timer
+    EXPECT_EQ(timer.GetPending(), 0U);
+    ASSERT_TRUE(timed.Ready());
+    timed.Then([](Timed<int>& result) {
+        EXPECT_EQ(result.status, TimeoutStatus::OK);
+        EXPECT_EQ(result.value, 5);
+    });
+}
+
+TEST(timer_service_test, timeout_cancels_input)
+{
+    TimerService timer;
+    auto [sender, receiver] = MakeOneShot<int>();
+    std::promise<TimeoutStatus> status;
+    WithTimeout(timer, std::move(receiver), TimerService::Clock::now() + 10ms).Then([&status](Timed<int>& result) {
+        EXPECT_FALSE(result.value.has_value());
+        status.set_value(result.status);
+    });
+    EXPECT_EQ(status.get_future().get(), TimeoutStatus::TIMEOUT);
+    EXPECT_TRUE(sender.IsCancelled());
+    // a late value is dropped
+    EXPECT_TRUE(sender.Send(5));
+}
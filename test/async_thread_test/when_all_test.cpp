@@ -0,0 +1,130 @@
+#include "async_thread/when_all.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+#include "async_thread/async_task.h"
+
+TEST(when_all_test, all_values_in_input_order)
+{
+    std::vector<OneShotSender<int>> senders;
+    std::vector<OneShotReceiver<int>> receivers;
+    for (int i = 0; i < 3; i++) {
+        auto [sender, receiver] = MakeOneShot<int>();
+        senders.push_back(std::move(sender));
+        receivers.push_back(std::move(receiver));
+    }
+
+    std::vector<int> got;
+    WhenAll(std::move(receivers)).Then([&got](std::vector<int>& values) { got = std::move(values); });
+    EXPECT_TRUE(senders[2].Send(12));
+    EXPECT_TRUE(senders[0].Send(10));
+    EXPECT_TRUE(got.empty());
+    EXPECT_TRUE(senders[1].Send(11));
+    EXPECT_EQ(got, std::vector<int>({10, 11, 12}));
+}
+
+TEST(when_all_test, empty_input_is_ready)
+{
+    auto all = WhenAll(std::vector<OneShotReceiver<int>>());
+    EXPECT_TRUE(all.Ready());
+}
+
+TEST(when_all_test, values_from_many_threads)
+{
+    constexpr int num = 8;
+    std::vector<std::thread> producers;
+    std::vector<OneShotReceiver<std::string>> receivers;
+    for (int i = 0; i < num; i++) {
+        auto [sender, receiver] = MakeOneShot<std::string>();
+        receivers.push_back(std::move(receiver));
+        producers.emplace_back([sender = std::move(sender), i]() mutable { sender.Send(std::to_string(i)); });
+    }
+
+    std::atomic<uint32_t> done {0};
+    std::vector<std::string> got;
+    WhenAll(std::move(receivers)).Then([&](std::vector<std::string>& values) {
+        got = std::move(values);
+        done.store(1);
+    });
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    ASSERT_EQ(done.load(), 1U);
+    for (int i = 0; i < num; i++) {
+        EXPECT_EQ(got[i], std::to_string(i));
+    }
+}
+
+TEST(when_all_test, any_takes_first_and_cancels_others)
+{
+    auto [slowSender, slowReceiver] = MakeOneShot<int>();
+    auto [fastSender, fastReceiver] = MakeOneShot<int>();
+    std::vector<OneShotReceiver<int>> receivers;
+    receivers.push_back(std::move(slowReceiver));
+    receivers.push_back(std::move(fastReceiver));
+
+    std::pair<size_t, int> got {0, 0};
+    int calls = 0;
+    WhenAny(std::move(receivers)).Then([&](std::pair<size_t, int>& first) {
+        got = first;
+        calls++;
+    });
+    EXPECT_FALSE(slowSender.IsCancelled());
+    EXPECT_TRUE(fastSender.Send(2));
+    EXPECT_EQ(got, std::make_pair(size_t(1), 2));
+    EXPECT_TRUE(slowSender.IsCancelled());
+    EXPECT_FALSE(fastSender.IsCancelled());
+
+    // a late value is dropped
+    EXPECT_TRUE(slowSender.Send(1));
+    EXPECT_EQ(calls, 1);
+}
+
+TEST(when_all_test, hedged_async_tasks)
+{
+    ThreadPool executor(2, 10);
+    executor.Init();
+    AsyncTask task(executor);
+    std::vector<OneShotReceiver<AsyncTask::TaskContent>> receivers;
+    receivers.push_back(task.Start());
+    receivers.push_back(task.Start());
+
+    auto [doneSender, doneReceiver] = MakeOneShot<int>();
+    WhenAny(std::move(receivers)).Then([doneSender = std::move(doneSender)](auto& first) mutable {
+        EXPECT_LT(first.first, 2U);
+        doneSender.Send(first.second.id);
+    });
+    std::promise<int> id;
+    doneReceiver.Then([&id](int& value) { id.set_value(value); });
+    EXPECT_EQ(id.get_future().get(), 1);
+    executor.Destroy();
+}
+
+TEST(when_all_test, dropped_inputs_free_callbacks)
+{
+    auto captured = std::make_shared<int>(0);
+    {
+        auto [sender, receiver] = MakeOneShot<int>();
+        std::vector<OneShotReceiver<int>> receivers;
+        receivers.push_back(std::move(receiver));
+        auto any = WhenAny(std::move(receivers));
+        any.Then([captured](std::pair<size_t, int>&) { (*captured)++; });
+        EXPECT_EQ(captured.use_count(), 2);
+        // the input is never sent, nothing refers to the combined callback any more
+        sender = OneShotSender<int>();
+        EXPECT_EQ(captured.use_count(), 1);
+    }
+
+    {
+        auto [sender, receiver] = MakeOneShot<int>();
+        std::vector<OneShotReceiver<int>> receivers;
+        receivers.push_back(std::move(receiver));
+        WhenAny(std::move(receivers)).Then([captured](std::pair<size_t, int>&) { (*captured)++; });
+        EXPECT_TRUE(sender.Send(1));
+        EXPECT_EQ(captured.use_count(), 1);
+    }
+    EXPECT_EQ(*captured, 1);
+}
@@ -0,0 +1,48 @@
+#ifndef WORKER_GATE_H
+#define WORKER_GATE_H
+
+#include <cstdint>
+#include <future>
+#include "thread_pool/thread_pool.h"
+
+// keeps workers of an executor busy until Open, so tasks started in between wait in its queue
+class WorkerGate {
+public:
+    explicit WorkerGate(ThreadPool& executor, uint32_t workerNum = 1)
+    {
+        auto opened = _gate.get_future().share();
+        for (uint32_t i = 0; i < workerNum; i++) {
+            _holding = executor.AddTask([opened]() { opened.wait(); }).valid() && _holding;
+        }
+    }
+
+    // a test which fails before Open does not leave the workers blocked
+    ~WorkerGate()
+    {
+        Open();
+    }
+
+    WorkerGate(const WorkerGate&) = delete;
+    WorkerGate& operator=(const WorkerGate&) = delete;
+
+    // false if the executor has refused to hold some of the workers
+    bool IsHolding() const
+    {
+        return _holding;
+    }
+
+    void Open()
+    {
+        if (!_opened) {
+            _opened = true;
+            _gate.set_value();
+        }
+    }
+
+private:
+    std::promise<void> _gate;
+    bool _holding {true};
+    bool _opened {false};
+};
+
+#endif // WORKER_GATE_H
@@ -0,0 +1,66 @@
+#include "thread_pool/admission_controller.h"
+#include <gtest/gtest.h>
+#include "thread_pool/thread_pool.h"
+
+using namespace std::chrono_literals;
+
+TEST(admission_controller_test, admit_all_when_delay_below_target)
+{
+    AdmissionController ctrl(5ms, 100ms);
+    auto now = AdmissionController::Clock::now();
+    for (uint32_t i = 0; i < 100; i++) {
+        now += 1ms;
+        ctrl.OnDequeue(1ms, now);
+        EXPECT_TRUE(ctrl.Admit(now));
+    }
+
+    EXPECT_EQ(ctrl.GetStats().shed, 0);
+    EXPECT_EQ(ctrl.GetShedRate(), 0.0);
+}
+
+TEST(admission_controller_test, shed_after_delay_above_target_for_interval)
+{
+    AdmissionController ctrl(5ms, 100ms);
+    auto now = AdmissionController::Clock::now();
+
+    // above target, but not for a whole interval yet
+    ctrl.OnDequeue(20ms, now);
+    now += 50ms;
+    ctrl.OnDequeue(20ms, now);
+    EXPECT_TRUE(ctrl.Admit(now));
+
+    // a whole interval has passed, the first task is shed at once and the next one after an interval
+    now += 60ms;
+    ctrl.OnDequeue(20ms, now);
+    EXPECT_FALSE(ctrl.Admit(now));
+    EXPECT_TRUE(ctrl.Admit(now + 50ms));
+    EXPECT_FALSE(ctrl.Admit(now + 100ms));
+    // shed more frequently while delay stays above target
+    EXPECT_TRUE(ctrl.Admit(now + 160ms));
+    EXPECT_FALSE(ctrl.Admit(now + 171ms));
+
+    // delay goes back below target, stop shedding
+    ctrl.OnDequeue(1ms, now + 200ms);
+    EXPECT_TRUE(ctrl.Admit(now + 300ms));
+
+    auto stats = ctrl.GetStats();
+    EXPECT_EQ(stats.shed, 3);
+    EXPECT_EQ(stats.admitted, 4);
+    EXPECT_DOUBLE_EQ(ctrl.GetShedRate(), 3.0 / 7.0);
+}
+
+TEST(admission_controller_test, thread_pool_sheds_when_overloaded)
+{
+    ThreadPool threadPool(1, 10);
+    threadPool.EnableAdmissionControl(1ms, 5ms);
+    threadPool.Init();
+
+    // tasks come in twice as fast as the only worker can run them
+    for (uint32_t i = 0; i < 100; i++) {
+        (void)threadPool.AddTask([]() { std::this_thread::sleep_for(2ms); });
+        std::this_thread::sleep_for(1ms);
+    }
+
+    EXPECT_GT(threadPool.GetShedRate(), 0.0);
+    threadPool.Destroy();
+}
@@ -0,0 +1,67 @@
+#include "thread_pool/executor_registry.h"
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+
+TEST(executor_registry_test, threads_are_bounded)
+{
+    ExecutorRegistry registry(4, 1, 1);
+    EXPECT_EQ(registry.GetThreadNum(), 2);
+    EXPECT_NE(registry.Get(ExecutorRegistry::CPU_EXECUTOR), nullptr);
+    EXPECT_NE(registry.Get(ExecutorRegistry::IO_EXECUTOR), nullptr);
+
+    EXPECT_FALSE(registry.Register(ExecutorRegistry::IO_EXECUTOR, ExecutorKind::BLOCKING, 1, 1));
+    EXPECT_FALSE(registry.Register("disk", ExecutorKind::BLOCKING, 3, 1));
+    EXPECT_TRUE(registry.Register("disk", ExecutorKind::BLOCKING, 2, 1));
+    EXPECT_EQ(registry.GetThreadNum(), 4);
+    EXPECT_EQ(registry.Get("disk")->GetPoolSize(), 2);
+    EXPECT_EQ(registry.Get("net"), nullptr);
+}
+
+TEST(executor_registry_test, pool_gets_the_size_asked_for)
+{
+    constexpr uint32_t POOL_SIZE = 16;
+    constexpr uint32_t QUEUE_SIZE = 1024;
+    ExecutorRegistry registry(POOL_SIZE + 2, 1, 1);
+    ASSERT_TRUE(registry.Register("disk", ExecutorKind::BLOCKING, POOL_SIZE, QUEUE_SIZE));
+    EXPECT_EQ(registry.Get("disk")->GetPoolSize(), POOL_SIZE);
+    EXPECT_EQ(registry.GetThreadNum(), POOL_SIZE + 2);
+}
+
+TEST(executor_registry_test, offload_blocking_resumes_on_cpu_pool)
+{
+    ExecutorRegistry registry(2, 1, 1);
+    auto cpuThread = registry.Cpu().AddTask([]() { return std::this_thread::get_id(); }).get();
+    auto ioThread = registry.Io().AddTask([]() { return std::this_thread::get_id(); }).get();
+
+    std::thread::id blockingThread;
+    std::thread::id thenThread;
+    auto result = registry.OffloadBlocking(
+        [&blockingThread]() {
+            blockingThread = std::this_thread::get_id();
+            return std::string("file content");
+        },
+        [&thenThread](std::string content) {
+            thenThread = std::this_thread::get_id();
+            return content.size();
+        });
+
+    ASSERT_TRUE(result.valid());
+    EXPECT_EQ(result.get(), 12);
+    EXPECT_EQ(blockingThread, ioThread);
+    EXPECT_EQ(thenThread, cpuThread);
+
+    auto voidResult = registry.OffloadBlocking([]() {}, []() { return 1; });
+    EXPECT_EQ(voidResult.get(), 1);
+}
+
+TEST(executor_registry_test, offload_blocking_passes_exceptions_to_caller)
+{
+    ExecutorRegistry registry(2, 1, 1);
+    auto blockingFailed = registry.OffloadBlocking([]() -> int { throw std::runtime_error("io failed"); },
+                                                   [](int value) { return value; });
+    EXPECT_THROW(blockingFailed.get(), std::runtime_error);
+
+    auto thenFailed = registry.OffloadBlocking([]() { return 1; }, [](int) -> int { throw std::logic_error("bad"); });
+    EXPECT_THROW(thenFailed.get(), std::logic_error);
+}
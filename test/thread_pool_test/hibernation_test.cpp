@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+#include <numeric>
+#include "thread_pool/thread_pool.h"
+
+using namespace std::chrono_literals;
+
+TEST(hibernation_test, surplus_workers_exit_when_idle)
+{
+    ThreadPool threadPool(4, 10);
+    threadPool.EnableHibernation(20ms, 1);
+    threadPool.Init();
+    EXPECT_EQ(threadPool.GetActiveWorkerNum(), 4);
+
+    auto deadline = std::chrono::steady_clock::now() + 2s;
+    while ((threadPool.GetActiveWorkerNum() > 1) && (std::chrono::steady_clock::now() < deadline)) {
+        std::this_thread::sleep_for(5ms);
+    }
+    EXPECT_EQ(threadPool.GetActiveWorkerNum(), 1);
+    threadPool.Destroy();
+}
+
+TEST(hibernation_test, first_task_of_burst_resumes_all_workers)
+{
+    ThreadPool threadPool(3, 10);
+    threadPool.EnableHibernation(10ms, 1);
+    threadPool.Init();
+    auto deadline = std::chrono::steady_clock::now() + 2s;
+    while ((threadPool.GetActiveWorkerNum() > 1) && (std::chrono::steady_clock::now() < deadline)) {
+        std::this_thread::sleep_for(5ms);
+    }
+    ASSERT_EQ(threadPool.GetActiveWorkerNum(), 1);
+
+    // workers come back before the task is even picked up, so the three can run at the same time
+    std::atomic<uint32_t> arrived {0};
+    auto task = [&arrived]() {
+        arrived.fetch_add(1);
+        auto deadline = std::chrono::steady_clock::now() + 2s;
+        while ((arrived.load() < 3) && (std::chrono::steady_clock::now() < deadline)) {
+            std::this_thread::yield();
+        }
+        return arrived.load();
+    };
+    std::vector<std::future<uint32_t>> futures;
+    for (uint32_t i = 0; i < 3; i++) {
+        futures.emplace_back(threadPool.AddTask(task));
+        EXPECT_EQ(threadPool.GetActiveWorkerNum(), 3);
+    }
+    for (auto& f : futures) {
+        EXPECT_EQ(f.get(), 3);
+    }
+    threadPool.Destroy();
+}
+
+TEST(hibernation_test, repeated_hibernate_and_resume)
+{
+    BasicThreadPool<LockedQueue, IdleWait, MoveOnlyTask, NoStats, NoAdmission> threadPool(4, 10);
+    threadPool.EnableHibernation(1ms, 2);
+    threadPool.Init();
+
+    uint64_t sum = 0;
+    for (uint64_t i = 1; i <= 50; i++) {
+        sum += threadPool.AddTask([i]() { return i; }).get();
+        if (i % 10 == 0) {
+            std::this_thread::sleep_for(10ms);
+        }
+    }
+    EXPECT_EQ(sum, 50 * 51 / 2);
+    EXPECT_GE(threadPool.GetActiveWorkerNum(), 2);
+    threadPool.Destroy();
+}
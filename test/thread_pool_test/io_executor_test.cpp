@@ -0,0 +1,103 @@
+#include "thread_pool/io_executor.h"
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <cstdio>
+#include <string>
+
+namespace {
+class TempFile {
+public:
+    TempFile()
+    {
+        char path[] = "/tmp/io_executor_test_XXXXXX";
+        _fd = mkstemp(path);
+        _path = path;
+    }
+    ~TempFile()
+    {
+        close(_fd);
+        unlink(_path.c_str());
+    }
+
+    int Fd() const
+    {
+        return _fd;
+    }
+
+private:
+    int _fd;
+    std::string _path;
+};
+
+void ReadBackWhatWasWritten(IoExecutor::Backend backend)
+{
+    constexpr uint32_t BLOCK_NUM = 200;
+    constexpr size_t BLOCK_SIZE = 64;
+    ThreadPool threadPool(2, 10);
+    threadPool.Init();
+    TempFile file;
+    std::vector<std::string> blocks;
+    for (uint32_t i = 0; i < BLOCK_NUM; i++) {
+        blocks.emplace_back(BLOCK_SIZE, static_cast<char>('a' + i % 26));
+    }
+
+    std::vector<std::string> readBack(BLOCK_NUM, std::string(BLOCK_SIZE, '\0'));
+    std::vector<std::promise<ssize_t>> written(BLOCK_NUM);
+    std::vector<std::promise<ssize_t>> read(BLOCK_NUM);
+    {
+        IoExecutor executor(threadPool, 16, 2, backend);
+        if (backend == IoExecutor::Backend::BLOCKING) {
+            EXPECT_FALSE(executor.UsesIoUring());
+        }
+
+        // far more requests than the ring can hold, the rest wait for free slots
+        for (uint32_t i = 0; i < BLOCK_NUM; i++) {
+            ASSERT_TRUE(executor.Write(file.Fd(), blocks[i].data(), BLOCK_SIZE, i * BLOCK_SIZE,
+                                       [&written, i](ssize_t result) { written[i].set_value(result); }));
+        }
+        for (auto& promise : written) {
+            EXPECT_EQ(promise.get_future().get(), BLOCK_SIZE);
+        }
+
+        for (uint32_t i = 0; i < BLOCK_NUM; i++) {
+            ASSERT_TRUE(executor.Read(file.Fd(), readBack[i].data(), BLOCK_SIZE, i * BLOCK_SIZE,
+                                      [&read, i](ssize_t result) { read[i].set_value(result); }));
+        }
+    }
+
+    // the executor finishes accepted requests before it goes away
+    for (uint32_t i = 0; i < BLOCK_NUM; i++) {
+        EXPECT_EQ(read[i].get_future().get(), BLOCK_SIZE);
+        EXPECT_EQ(readBack[i], blocks[i]);
+    }
+    threadPool.Destroy();
+}
+}  // namespace
+
+TEST(io_executor_test, read_back_with_io_uring_or_fallback)
+{
+    ReadBackWhatWasWritten(IoExecutor::Backend::AUTO);
+}
+
+TEST(io_executor_test, read_back_with_blocking_threads)
+{
+    ReadBackWhatWasWritten(IoExecutor::Backend::BLOCKING);
+}
+
+TEST(io_executor_test, continuation_runs_on_pool_with_error)
+{
+    ThreadPool threadPool(1, 10);
+    threadPool.Init();
+    IoExecutor executor(threadPool, 8, 1);
+
+    char buf[8];
+    std::promise<std::pair<ssize_t, bool>> done;
+    ASSERT_TRUE(executor.Read(-1, buf, sizeof(buf), 0, [&done](ssize_t result) {
+        done.set_value({result, ThreadPool::CurrentWorker() != nullptr});
+    }));
+    auto [result, onWorker] = done.get_future().get();
+    EXPECT_EQ(result, -EBADF);
+    EXPECT_TRUE(onWorker);
+    threadPool.Destroy();
+}
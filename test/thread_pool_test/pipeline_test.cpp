@@ -0,0 +1,135 @@
+#include "thread_pool/pipeline.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <stdexcept>
+#include "thread_pool/thread_pool.h"
+
+namespace {
+struct Record {
+    uint32_t id;
+    uint32_t value;
+};
+
+void UpdateMax(std::atomic<uint32_t>& maxVal, uint32_t val)
+{
+    uint32_t cur = maxVal.load();
+    while ((val > cur) && !maxVal.compare_exchange_weak(cur, val)) {
+    }
+}
+}  // namespace
+
+TEST(pipeline_test, serial_in_order_stage_keeps_source_order)
+{
+    constexpr uint32_t ITEM_NUM = 200;
+    ThreadPool threadPool(4, 4);
+    threadPool.Init();
+
+    uint32_t nextId = 0;
+    std::vector<uint32_t> written;
+    Pipeline<Record> pipeline(threadPool, 8, 3);
+    pipeline.AddStage(StageMode::PARALLEL, [](Record& rec) {
+        // make later items overtake earlier ones
+        if (rec.id % 3 == 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+        rec.value = rec.id * 2;
+    })
+        .AddStage(StageMode::SERIAL_IN_ORDER, [&written](Record& rec) { written.push_back(rec.value); });
+
+    pipeline.Run([&nextId](Record& rec) {
+        if (nextId == ITEM_NUM) {
+            return false;
+        }
+        rec.id = nextId++;
+        return true;
+    });
+
+    ASSERT_EQ(written.size(), ITEM_NUM);
+    for (uint32_t i = 0; i < ITEM_NUM; i++) {
+        EXPECT_EQ(written[i], i * 2);
+    }
+    threadPool.Destroy();
+}
+
+TEST(pipeline_test, tokens_limit_items_in_flight)
+{
+    constexpr uint32_t ITEM_NUM = 100;
+    constexpr uint32_t MAX_TOKENS = 3;
+    ThreadPool threadPool(4, 4);
+    threadPool.Init();
+
+    uint32_t nextId = 0;
+    std::atomic<uint32_t> alive {0};
+    std::atomic<uint32_t> maxAlive {0};
+    std::atomic<uint32_t> serialRunning {0};
+    std::atomic<uint32_t> maxSerialRunning {0};
+    std::vector<uint32_t> done;
+
+    Pipeline<Record> pipeline(threadPool, MAX_TOKENS, 3);
+    pipeline.AddStage(StageMode::PARALLEL, [](Record& rec) { rec.value = rec.id + 1; })
+        .AddStage(StageMode::SERIAL_OUT_OF_ORDER,
+                  [&](Record& rec) {
+                      UpdateMax(maxSerialRunning, ++serialRunning);
+                      std::this_thread::yield();
+                      done.push_back(rec.value);
+                      serialRunning--;
+                  })
+        .AddStage(StageMode::PARALLEL, [&alive](Record&) { alive--; });
+
+    pipeline.Run([&](Record& rec) {
+        if (nextId == ITEM_NUM) {
+            return false;
+        }
+        rec.id = nextId++;
+        UpdateMax(maxAlive, ++alive);
+        return true;
+    });
+
+    EXPECT_LE(maxAlive.load(), MAX_TOKENS);
+    EXPECT_EQ(maxSerialRunning.load(), 1);
+    ASSERT_EQ(done.size(), ITEM_NUM);
+    std::sort(done.begin(), done.end());
+    for (uint32_t i = 0; i < ITEM_NUM; i++) {
+        EXPECT_EQ(done[i], i + 1);
+    }
+    threadPool.Destroy();
+}
+
+TEST(pipeline_test, items_thrown_on_are_dropped_without_blocking_the_stage)
+{
+    constexpr uint32_t ITEM_NUM = 50;
+    ThreadPool threadPool(4, 4);
+    threadPool.Init();
+
+    uint32_t nextId = 0;
+    std::vector<uint32_t> written;
+    Pipeline<Record> pipeline(threadPool, 4, 2);
+    pipeline.AddStage(StageMode::SERIAL_OUT_OF_ORDER, [](Record& rec) {
+        if (rec.id % 10 == 0) {
+            throw std::runtime_error("bad record");
+        }
+        rec.value = rec.id;
+    })
+        .AddStage(StageMode::SERIAL_IN_ORDER, [&written](Record& rec) { written.push_back(rec.value); });
+
+    pipeline.Run([&nextId](Record& rec) {
+        if (nextId == ITEM_NUM) {
+            return false;
+        }
+        rec.id = nextId++;
+        if (rec.id == 25) {
+            throw std::runtime_error("bad input");
+        }
+        return true;
+    });
+
+    // the failed items do not reach the in-order stage, and the ones after them are not held back
+    std::vector<uint32_t> expected;
+    for (uint32_t i = 0; i < ITEM_NUM; i++) {
+        if ((i % 10 != 0) && (i != 25)) {
+            expected.push_back(i);
+        }
+    }
+    EXPECT_EQ(written, expected);
+    threadPool.Destroy();
+}
@@ -0,0 +1,101 @@
+#include "thread_pool/reactor.h"
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "thread_pool/thread_pool.h"
+
+using namespace std::chrono_literals;
+
+namespace {
+struct SocketPair {
+    SocketPair()
+    {
+        (void)socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds);
+    }
+    ~SocketPair()
+    {
+        close(fds[0]);
+        close(fds[1]);
+    }
+
+    int fds[2] {-1, -1};
+};
+
+// read all that is there, the fd is one-shot so nothing is lost for the next round
+size_t Drain(int fd)
+{
+    char buf[64];
+    size_t total = 0;
+    ssize_t len;
+    while ((len = read(fd, buf, sizeof(buf))) > 0) {
+        total += static_cast<size_t>(len);
+    }
+    return total;
+}
+}  // namespace
+
+TEST(reactor_test, poll_runs_handler_on_calling_thread)
+{
+    Reactor reactor(8);
+    ASSERT_TRUE(reactor.Valid());
+    SocketPair pair;
+    size_t received = 0;
+    ASSERT_TRUE(reactor.Add(pair.fds[0], EPOLLIN, [&](uint32_t) { received += Drain(pair.fds[0]); }));
+    EXPECT_FALSE(reactor.Add(pair.fds[0], EPOLLIN, [](uint32_t) {}));
+
+    EXPECT_TRUE(reactor.Poll(0));
+    EXPECT_EQ(received, 0);
+
+    ASSERT_EQ(write(pair.fds[1], "hello", 5), 5);
+    EXPECT_TRUE(reactor.Poll(1000));
+    EXPECT_EQ(received, 5);
+
+    // armed again after the handler
+    ASSERT_EQ(write(pair.fds[1], "abc", 3), 3);
+    EXPECT_TRUE(reactor.Poll(1000));
+    EXPECT_EQ(received, 8);
+
+    EXPECT_TRUE(reactor.Remove(pair.fds[0]));
+    ASSERT_EQ(write(pair.fds[1], "x", 1), 1);
+    EXPECT_TRUE(reactor.Poll(10));
+    EXPECT_EQ(received, 8);
+}
+
+TEST(reactor_test, idle_workers_lead_reactor)
+{
+    constexpr uint32_t CONN_NUM = 3;
+    constexpr uint32_t ROUND_NUM = 50;
+    Reactor reactor(16);
+    ThreadPool threadPool(2, 10);
+    threadPool.AttachReactor(reactor);
+    threadPool.Init();
+
+    SocketPair pairs[CONN_NUM];
+    std::atomic<size_t> received {0};
+    std::atomic<uint32_t> offWorker {0};
+    for (auto& pair : pairs) {
+        int fd = pair.fds[0];
+        ASSERT_TRUE(reactor.Add(fd, EPOLLIN, [&, fd](uint32_t) {
+            if (ThreadPool::CurrentWorker() == nullptr) {
+                offWorker.fetch_add(1);
+            }
+            received.fetch_add(Drain(fd));
+        }));
+    }
+
+    for (uint32_t i = 0; i < ROUND_NUM; i++) {
+        for (auto& pair : pairs) {
+            ASSERT_EQ(write(pair.fds[1], "x", 1), 1);
+        }
+        // tasks are still served while a worker waits in epoll
+        ASSERT_EQ(threadPool.AddTask([i]() { return i; }).get(), i);
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + 2s;
+    while ((received.load() < CONN_NUM * ROUND_NUM) && (std::chrono::steady_clock::now() < deadline)) {
+        std::this_thread::sleep_for(1ms);
+    }
+    EXPECT_EQ(received.load(), CONN_NUM * ROUND_NUM);
+    EXPECT_EQ(offWorker.load(), 0);
+    threadPool.Destroy();
+}
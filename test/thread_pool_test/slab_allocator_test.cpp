@@ -0,0 +1,109 @@
+#include "thread_pool/slab_allocator.h"
+#include <gtest/gtest.h>
+#include <array>
+#include <numeric>
+#include <thread>
+#include <vector>
+#include "thread_pool/thread_pool.h"
+
+TEST(slab_allocator_test, freed_block_is_reused_by_same_thread)
+{
+    SlabHeap heap;
+    void* first = heap.Allocate(40, 8);
+    heap.Deallocate(first, 40, 8);
+    void* second = heap.Allocate(40, 8);
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(heap.GetChunkNum(), 1);
+    heap.Deallocate(second, 40, 8);
+}
+
+TEST(slab_allocator_test, blocks_freed_by_other_thread_go_back_to_owner)
+{
+    constexpr size_t BLOCK_NUM = 2000;
+    SlabHeap heap;
+    std::vector<void*> blocks;
+    for (size_t i = 0; i < BLOCK_NUM; i++) {
+        blocks.push_back(heap.Allocate(64, 8));
+    }
+    size_t chunkNum = heap.GetChunkNum();
+
+    std::thread other([&heap, &blocks]() {
+        for (auto block : blocks) {
+            heap.Deallocate(block, 64, 8);
+        }
+    });
+    other.join();
+
+    // all of them are taken back from the remote list, no new chunk is needed
+    for (auto& block : blocks) {
+        block = heap.Allocate(64, 8);
+    }
+    EXPECT_EQ(heap.GetChunkNum(), chunkNum);
+    for (auto block : blocks) {
+        heap.Deallocate(block, 64, 8);
+    }
+}
+
+TEST(slab_allocator_test, thread_which_only_freed_can_allocate_later)
+{
+    SlabHeap heap;
+    void* block = heap.Allocate(64, 8);
+    std::thread other([&heap, block]() {
+        heap.Deallocate(block, 64, 8);
+        // the missing cache was remembered by the free above, allocating still makes one
+        void* own = heap.Allocate(64, 8);
+        heap.Deallocate(own, 64, 8);
+        EXPECT_EQ(heap.Allocate(64, 8), own);
+        heap.Deallocate(own, 64, 8);
+    });
+    other.join();
+    EXPECT_EQ(heap.GetChunkNum(), 2);
+}
+
+TEST(slab_allocator_test, cache_of_exited_thread_is_adopted)
+{
+    SlabHeap heap;
+    void* block = nullptr;
+    std::thread([&heap, &block]() {
+        block = heap.Allocate(64, 8);
+        heap.Deallocate(block, 64, 8);
+    }).join();
+    EXPECT_EQ(heap.GetChunkNum(), 1);
+
+    // the next thread takes over the cache with its free block instead of making a new chunk
+    std::thread([&heap, block]() {
+        void* own = heap.Allocate(64, 8);
+        EXPECT_EQ(own, block);
+        heap.Deallocate(own, 64, 8);
+    }).join();
+    EXPECT_EQ(heap.GetChunkNum(), 1);
+}
+
+TEST(slab_allocator_test, large_block_goes_to_global_allocator)
+{
+    SlabHeap heap;
+    void* block = heap.Allocate(4096, 8);
+    EXPECT_EQ(heap.GetChunkNum(), 0);
+    heap.Deallocate(block, 4096, 8);
+}
+
+TEST(slab_allocator_test, pool_with_slab_task)
+{
+    BasicThreadPool<LockedQueue, BlockingWait, SlabTask, NoStats, NoAdmission> threadPool(3, 10);
+    threadPool.Init();
+
+    // captures bigger than the inline buffer of UniqueTask
+    std::array<uint64_t, 16> values {};
+    std::iota(values.begin(), values.end(), 1);
+    std::vector<std::future<uint64_t>> futures;
+    for (uint64_t i = 0; i < 10; i++) {
+        futures.emplace_back(threadPool.AddTask([values, i]() { return values[i] * 2; }));
+    }
+    for (uint64_t i = 0; i < 10; i++) {
+        EXPECT_EQ(futures[i].get(), values[i] * 2);
+    }
+
+    auto failed = threadPool.AddTask([]() { throw std::runtime_error("failed"); });
+    EXPECT_THROW(failed.get(), std::runtime_error);
+    threadPool.Destroy();
+}
@@ -0,0 +1,70 @@
+#include "thread_pool/task_tracer.h"
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include "thread_pool/thread_pool.h"
+
+namespace {
+size_t CountOf(const std::string& str, const std::string& sub)
+{
+    size_t count = 0;
+    for (auto pos = str.find(sub); pos != std::string::npos; pos = str.find(sub, pos + sub.size())) {
+        count++;
+    }
+    return count;
+}
+}  // namespace
+
+TEST(task_tracer_test, dump_task_spans_as_trace_events)
+{
+    constexpr uint32_t TASK_NUM = 6;
+    const std::string traceFile = "task_tracer_test.json";
+    ThreadPool threadPool(2, 2);
+    threadPool.EnableTracing(64);
+    threadPool.Init();
+
+    {
+        TaskTracer::ScopedLabel label("resize");
+        for (uint32_t i = 0; i < TASK_NUM; i++) {
+            threadPool.AddTask([]() {}).wait();
+        }
+    }
+    threadPool.Destroy();
+
+    ASSERT_TRUE(threadPool.DumpTrace(traceFile));
+    std::ifstream in(traceFile);
+    std::stringstream content;
+    content << in.rdbuf();
+    (void)std::remove(traceFile.c_str());
+
+    auto json = content.str();
+    EXPECT_EQ(json.rfind("{\"traceEvents\":[", 0), 0);
+    EXPECT_EQ(CountOf(json, "\"name\":\"resize\",\"cat\":\"task\",\"ph\":\"X\""), TASK_NUM);
+    EXPECT_EQ(CountOf(json, "\"ph\":\"s\""), TASK_NUM);
+    EXPECT_EQ(CountOf(json, "\"ph\":\"f\""), TASK_NUM);
+    EXPECT_EQ(CountOf(json, "\"name\":\"thread 1\""), 1);
+    EXPECT_GE(CountOf(json, "\"name\":\"worker "), 1);
+}
+
+TEST(task_tracer_test, ring_buffer_keeps_latest_events)
+{
+    TaskTracer tracer(8);
+    for (uint64_t id = 1; id <= 10; id++) {
+        tracer.Record(TaskTracer::EventType::START, id, "a");
+        tracer.Record(TaskTracer::EventType::END, id, "a");
+    }
+
+    std::stringstream out;
+    tracer.Dump(out);
+    // 8 events are kept and the oldest one may be torn by a writer, so only the last 3 tasks are complete
+    EXPECT_EQ(CountOf(out.str(), "\"ph\":\"X\""), 3);
+    EXPECT_NE(out.str().find("\"id\":10}"), std::string::npos);
+    EXPECT_EQ(out.str().find("\"id\":7}"), std::string::npos);
+}
+
+TEST(task_tracer_test, tracing_is_off_by_default)
+{
+    ThreadPool threadPool(1, 1);
+    EXPECT_FALSE(threadPool.DumpTrace("task_tracer_test_off.json"));
+}
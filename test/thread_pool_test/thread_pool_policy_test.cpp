@@ -0,0 +1,116 @@
+#include "thread_pool/thread_pool_policy.h"
+#include <gtest/gtest.h>
+#include <array>
+#include <chrono>
+#include <numeric>
+#include <thread>
+#include "thread_pool/thread_pool.h"
+
+namespace {
+template<typename Pool>
+void ExpectAllTasksDone(Pool& threadPool)
+{
+    constexpr int TASK_NUM = 50;
+    int sum = 0;
+    for (int i = 0; i < TASK_NUM; i++) {
+        auto f = threadPool.AddTask([](int val) { return val * 2; }, i);
+        // queue is small, so wait for every task instead of flooding it
+        ASSERT_TRUE(f.valid());
+        sum += f.get();
+    }
+    EXPECT_EQ(sum, TASK_NUM * (TASK_NUM - 1));
+}
+}  // namespace
+
+TEST(thread_pool_policy_test, lean_pool_exec_ok)
+{
+    LeanThreadPool threadPool(2, 2);
+    threadPool.Init();
+    ExpectAllTasksDone(threadPool);
+    threadPool.Destroy();
+}
+
+TEST(thread_pool_policy_test, lock_free_spin_pool_exec_ok)
+{
+    BasicThreadPool<LockFreeQueue, SpinWait, MoveOnlyTask, NoStats, NoAdmission> threadPool(2, 3);
+    threadPool.Init();
+    ExpectAllTasksDone(threadPool);
+    threadPool.Destroy();
+}
+
+TEST(thread_pool_policy_test, instrumented_pool_counts_tasks)
+{
+    InstrumentedThreadPool threadPool(3, 2);
+    threadPool.Init();
+    ExpectAllTasksDone(threadPool);
+    threadPool.Destroy();
+
+    auto stats = threadPool.GetStats();
+    EXPECT_EQ(stats.submitted, 50);
+    EXPECT_EQ(stats.executed, 50);
+    EXPECT_EQ(stats.rejected, 0);
+}
+
+TEST(thread_pool_policy_test, default_pool_publishes_metrics)
+{
+    auto executed = Metrics::GetCounter("thread_pool.executed").Get();
+    auto measured = Metrics::GetHistogram("thread_pool.task_ns").Get().count;
+    ThreadPool threadPool(3, 2);
+    threadPool.Init();
+    ExpectAllTasksDone(threadPool);
+    // a worker counts itself once it is in its loop, which may be after its first task is queued
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while ((threadPool.GetRunningWorkerNum() < 3) && (std::chrono::steady_clock::now() < deadline)) {
+        std::this_thread::yield();
+    }
+    EXPECT_EQ(threadPool.GetRunningWorkerNum(), 3);
+    threadPool.Destroy();
+
+    EXPECT_EQ(Metrics::GetCounter("thread_pool.executed").Get() - executed, 50);
+    EXPECT_EQ(Metrics::GetHistogram("thread_pool.task_ns").Get().count - measured, 50);
+    EXPECT_EQ(threadPool.GetRunningWorkerNum(), 0);
+}
+
+TEST(thread_pool_policy_test, queue_keeps_exact_capacity)
+{
+    LockFreeQueue<int> lockFreeQueue(3, 1);
+    PerWorkerQueue<int> perWorkerQueue(3, 2);
+    for (int i = 0; i < 3; i++) {
+        EXPECT_TRUE(lockFreeQueue.TryPush(int(i)));
+        EXPECT_TRUE(perWorkerQueue.TryPush(int(i)));
+    }
+    EXPECT_FALSE(lockFreeQueue.TryPush(3));
+    EXPECT_FALSE(perWorkerQueue.TryPush(3));
+
+    int val = 0;
+    EXPECT_TRUE(lockFreeQueue.TryPop(val, 0));
+    EXPECT_EQ(val, 0);
+    // worker 1 takes its own item first, then steals the ones of worker 0
+    EXPECT_TRUE(perWorkerQueue.TryPop(val, 1));
+    EXPECT_EQ(val, 1);
+    EXPECT_TRUE(perWorkerQueue.TryPop(val, 1));
+    EXPECT_TRUE(perWorkerQueue.TryPop(val, 1));
+    EXPECT_TRUE(perWorkerQueue.Empty());
+}
+
+TEST(thread_pool_policy_test, unique_task_holds_move_only_and_large_callable)
+{
+    int small = 0;
+    auto ptr = std::make_unique<int>(7);
+    UniqueTask inlineTask([&small, p = std::move(ptr)]() { small = *p; });
+
+    std::array<int, 64> big {};
+    std::iota(big.begin(), big.end(), 0);
+    int total = 0;
+    UniqueTask heapTask([&total, big]() { total = std::accumulate(big.begin(), big.end(), 0); });
+
+    UniqueTask moved(std::move(inlineTask));
+    EXPECT_FALSE(static_cast<bool>(inlineTask));
+    heapTask();
+    EXPECT_EQ(total, 2016);
+
+    // the heap callable is released and the inline one is moved in
+    heapTask = std::move(moved);
+    heapTask();
+    EXPECT_EQ(small, 7);
+}
@@ -0,0 +1,52 @@
+#include "thread_pool/watchdog.h"
+#include <gtest/gtest.h>
+#include <string>
+#include "thread_pool/thread_pool.h"
+
+using namespace std::chrono_literals;
+
+TEST(watchdog_test, report_stalled_task_with_call_site)
+{
+    ThreadPool threadPool(1, 2);
+    std::mutex reportLock;
+    std::vector<Watchdog::Report> reports;
+    threadPool.EnableWatchdog(20ms, false, [&](const Watchdog::Report& report) {
+        std::lock_guard<std::mutex> lock {reportLock};
+        reports.push_back(report);
+    });
+    threadPool.Init();
+
+    uint32_t line = __LINE__ + 1;
+    auto f = THREAD_POOL_ADD_TASK(threadPool, []() { std::this_thread::sleep_for(150ms); });
+    f.wait();
+    // a quick task is never reported
+    threadPool.AddTask([]() {}).wait();
+    threadPool.Destroy();
+
+    ASSERT_EQ(reports.size(), 1);
+    EXPECT_EQ(reports[0].workerId, 0);
+    EXPECT_EQ(reports[0].line, line);
+    EXPECT_NE(std::string(reports[0].file).find("watchdog_test.cpp"), std::string::npos);
+    EXPECT_GE(reports[0].elapsed, 20ms);
+}
+
+TEST(watchdog_test, compensator_keeps_pool_serving)
+{
+    ThreadPool threadPool(1, 4);
+    threadPool.EnableWatchdog(20ms, true, [](const Watchdog::Report&) {});
+    threadPool.Init();
+
+    std::promise<void> release;
+    auto stalled = threadPool.AddTask([future = release.get_future().share()]() { future.wait(); });
+    std::this_thread::sleep_for(5ms);
+
+    // the only worker is stuck, the task can only be run by a compensator
+    auto quick = threadPool.AddTask([]() { return 1; });
+    ASSERT_EQ(quick.wait_for(2s), std::future_status::ready);
+    EXPECT_EQ(quick.get(), 1);
+    EXPECT_NE(stalled.wait_for(0ms), std::future_status::ready);
+
+    release.set_value();
+    stalled.wait();
+    threadPool.Destroy();
+}
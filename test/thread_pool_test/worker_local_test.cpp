@@ -0,0 +1,72 @@
+#include "thread_pool/worker_local.h"
+#include <gtest/gtest.h>
+#include <string>
+#include "thread_pool/thread_pool.h"
+
+namespace {
+struct ParseBuffer {
+    std::string data;
+    uint32_t useCount {0};
+};
+}  // namespace
+
+TEST(worker_local_test, slot_is_reused_by_tasks_on_same_worker)
+{
+    ThreadPool threadPool(1, 2);
+    threadPool.Init();
+    EXPECT_EQ(ThreadPool::CurrentWorker(), nullptr);
+
+    std::vector<ParseBuffer*> buffers;
+    for (uint32_t i = 0; i < 5; i++) {
+        auto f = threadPool.AddTask([]() {
+            auto& buffer = ThreadPool::CurrentWorker()->Local<ParseBuffer>();
+            buffer.useCount++;
+            return &buffer;
+        });
+        buffers.push_back(f.get());
+    }
+    threadPool.Destroy();
+
+    for (auto buffer : buffers) {
+        EXPECT_EQ(buffer, buffers.front());
+    }
+    EXPECT_EQ(buffers.front()->useCount, 5);
+}
+
+TEST(worker_local_test, arena_is_reset_between_tasks)
+{
+    constexpr size_t CHUNK_SIZE = 256;
+    ThreadPool threadPool(1, 2);
+    threadPool.EnableScratchArena(CHUNK_SIZE);
+    threadPool.Init();
+
+    auto allocate = [](size_t count) {
+        std::pmr::vector<uint64_t> values(count, 0, ThreadPool::CurrentWorker()->Arena());
+        return reinterpret_cast<uintptr_t>(values.data());
+    };
+    auto first = threadPool.AddTask(allocate, 8).get();
+    auto second = threadPool.AddTask(allocate, 8).get();
+    EXPECT_EQ(first, second);
+
+    // a task needs more than a chunk, chunks are merged afterwards
+    (void)threadPool.AddTask(allocate, 100).get();
+    auto capacity = threadPool.AddTask([]() { return ThreadPool::CurrentWorker()->Arena()->Capacity(); }).get();
+    EXPECT_GE(capacity, CHUNK_SIZE + 100 * sizeof(uint64_t));
+    threadPool.Destroy();
+}
+
+TEST(worker_local_test, arena_keeps_alignment)
+{
+    ScratchArena arena(64);
+    EXPECT_NE(arena.allocate(3, 1), nullptr);
+    for (uint32_t i = 0; i < 4; i++) {
+        auto aligned = arena.allocate(40, 64);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(aligned) % 64, 0);
+    }
+
+    // all chunks are merged into one, the first block starts from its beginning again
+    arena.Reset();
+    auto first = arena.allocate(8, 8);
+    arena.Reset();
+    EXPECT_EQ(arena.allocate(8, 8), first);
+}
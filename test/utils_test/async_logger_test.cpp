@@ -0,0 +1,112 @@
+#include "utils/async_logger.h"
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "utils/utils.h"
+
+using namespace std::chrono_literals;
+
+namespace {
+std::string ReadAll(FILE* file)
+{
+    std::string content;
+    rewind(file);
+    char buf[256];
+    size_t len;
+    while ((len = fread(buf, 1, sizeof(buf), file)) > 0) {
+        content.append(buf, len);
+    }
+    return content;
+}
+
+uint32_t CountLines(const std::string& content, const std::string& prefix)
+{
+    uint32_t num = 0;
+    std::istringstream in(content);
+    for (std::string line; std::getline(in, line);) {
+        num += (line.rfind(prefix, 0) == 0) ? 1 : 0;
+    }
+    return num;
+}
+}  // namespace
+
+TEST(async_logger_test, records_of_all_threads_are_written_on_flush)
+{
+    constexpr uint32_t THREAD_NUM = 4;
+    constexpr uint32_t RECORD_NUM = 500;
+    FILE* out = tmpfile();
+    ASSERT_NE(out, nullptr);
+    {
+        // small buffers and a long interval, so writers keep filling up their buffers
+        AsyncLogger logger(out, 256, AsyncLogger::FullPolicy::BLOCK, 1s);
+        std::vector<std::thread> threads;
+        for (uint32_t t = 0; t < THREAD_NUM; t++) {
+            threads.emplace_back([&logger, t]() {
+                for (uint32_t i = 0; i < RECORD_NUM; i++) {
+                    std::string record = "thread" + std::to_string(t) + " record" + std::to_string(i) + "\n";
+                    logger.Write(record.data(), record.size());
+                }
+            });
+        }
+        for (auto& th : threads) {
+            th.join();
+        }
+
+        logger.Flush();
+        std::string content = ReadAll(out);
+        EXPECT_EQ(logger.GetDropped(), 0);
+        for (uint32_t t = 0; t < THREAD_NUM; t++) {
+            EXPECT_EQ(CountLines(content, "thread" + std::to_string(t) + " "), RECORD_NUM);
+        }
+        // records of one thread keep their order
+        auto first = content.find("thread0 record0\n");
+        auto last = content.find("thread0 record499\n");
+        EXPECT_LT(first, last);
+    }
+    fclose(out);
+}
+
+TEST(async_logger_test, drop_policy_never_waits)
+{
+    FILE* out = tmpfile();
+    ASSERT_NE(out, nullptr);
+    {
+        AsyncLogger logger(out, 64, AsyncLogger::FullPolicy::DROP, 1s);
+        std::string record(40, 'x');
+        record.back() = '\n';
+        // the second one has no room until the flusher runs
+        logger.Write(record.data(), record.size());
+        logger.Write(record.data(), record.size());
+        EXPECT_EQ(logger.GetDropped(), 1);
+        logger.Flush();
+        EXPECT_EQ(ReadAll(out), record);
+    }
+    fclose(out);
+}
+
+TEST(async_logger_test, remaining_records_are_written_on_destroy)
+{
+    FILE* out = tmpfile();
+    ASSERT_NE(out, nullptr);
+    {
+        AsyncLogger logger(out, 1024, AsyncLogger::FullPolicy::BLOCK, 1h);
+        logger.Write("last words\n", 11);
+    }
+    EXPECT_EQ(ReadAll(out), "last words\n");
+    fclose(out);
+}
+
+TEST(async_logger_test, print_macros_format_one_line_per_record)
+{
+    testing::internal::CaptureStdout();
+    PRINT_INFO("value is %d\n", 42);
+    PRINT_ERROR("no newline %s", "here");
+    AsyncLogger::Default().Flush();
+    std::string content = testing::internal::GetCapturedStdout();
+    EXPECT_NE(content.find("[INFO][async_logger_test.cpp:"), std::string::npos);
+    EXPECT_NE(content.find("] value is 42\n"), std::string::npos);
+    EXPECT_NE(content.find("] no newline here\n"), std::string::npos);
+    EXPECT_EQ(CountLines(content, "[ERROR]"), 1);
+}
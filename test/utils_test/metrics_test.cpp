@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "utils/metrics.h"
+
+TEST(metrics_test, counter_sums_all_threads)
+{
+    auto& counter = Metrics::GetCounter("metrics_test.counter");
+    EXPECT_EQ(&counter, &Metrics::GetCounter("metrics_test.counter"));
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 20; i++) {
+        threads.emplace_back([&counter]() {
+            for (int j = 0; j < 1000; j++) {
+                counter.Add(1);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(counter.Get(), 20000);
+
+    auto& gauge = Metrics::GetGauge("metrics_test.counter");
+    gauge.Set(5);
+    gauge.Add(-2);
+    EXPECT_EQ(gauge.Get(), 3);
+    EXPECT_EQ(counter.Get(), 20000);
+}
+
+TEST(metrics_test, histogram_buckets_cover_all_values)
+{
+    using Histogram = Metrics::Histogram;
+    EXPECT_EQ(Histogram::BucketOf(0), 0);
+    EXPECT_EQ(Histogram::BucketOf(Histogram::SUB_BUCKET_NUM - 1), Histogram::SUB_BUCKET_NUM - 1);
+    EXPECT_EQ(Histogram::BucketOf(UINT64_MAX), Histogram::BUCKET_NUM - 1);
+    EXPECT_EQ(Histogram::BucketHigh(Histogram::BUCKET_NUM - 1), UINT64_MAX);
+    for (size_t bucket = 1; bucket < Histogram::BUCKET_NUM; bucket++) {
+        ASSERT_EQ(Histogram::BucketLow(bucket), Histogram::BucketHigh(bucket - 1) + 1);
+        ASSERT_EQ(Histogram::BucketOf(Histogram::BucketLow(bucket)), bucket);
+        ASSERT_EQ(Histogram::BucketOf(Histogram::BucketHigh(bucket)), bucket);
+    }
+}
+
+TEST(metrics_test, histogram_percentiles_within_precision)
+{
+    auto& histogram = Metrics::GetHistogram("metrics_test.latency");
+    std::thread other([&histogram]() {
+        for (uint64_t value = 1; value <= 5000; value++) {
+            histogram.Record(value * 1000);
+        }
+    });
+    for (uint64_t value = 5001; value <= 10000; value++) {
+        histogram.Record(value * 1000);
+    }
+    other.join();
+
+    auto snapshot = histogram.Get();
+    EXPECT_EQ(snapshot.count, 10000);
+    EXPECT_EQ(snapshot.max, 10000000);
+    EXPECT_EQ(snapshot.sum, 1000ULL * 10000 * 10001 / 2);
+    for (double q : {0.5, 0.9, 0.99}) {
+        auto exact = static_cast<double>(q * 10000 * 1000);
+        auto got = static_cast<double>(snapshot.Percentile(q));
+        EXPECT_GE(got, exact);
+        EXPECT_LE(got, exact * (1.0 + 1.0 / Metrics::Histogram::SUB_BUCKET_NUM));
+    }
+    EXPECT_EQ(snapshot.Percentile(1.0), snapshot.max);
+}
+
+TEST(metrics_test, exporter_writes_snapshot_file)
+{
+    std::string file = "metrics_test_export.json";
+    (void)std::remove(file.c_str());
+    Metrics::GetCounter("metrics_test.exported").Add(42);
+    Metrics::GetHistogram("metrics_test.exported_ns").Record(7);
+    {
+        MetricsExporter exporter(file, std::chrono::milliseconds(5), Metrics::Format::JSON);
+        while (exporter.GetExported() == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    std::ifstream in(file);
+    std::stringstream content;
+    content << in.rdbuf();
+    EXPECT_NE(content.str().find("\"metrics_test.exported\":42"), std::string::npos);
+    EXPECT_NE(content.str().find("\"metrics_test.exported_ns\":{\"count\":1,\"sum\":7,\"max\":7,\"p50\":7"),
+              std::string::npos);
+    (void)std::remove(file.c_str());
+
+    std::ostringstream text;
+    Metrics::Dump(text, Metrics::Format::TEXT);
+    EXPECT_NE(text.str().find("counter metrics_test.exported 42\n"), std::string::npos);
+}
@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <thread>
+#include "utils/profiler.h"
+
+namespace {
+size_t CountOf(const std::string& text, const std::string& pattern)
+{
+    size_t count = 0;
+    for (size_t pos = text.find(pattern); pos != std::string::npos; pos = text.find(pattern, pos + 1)) {
+        count++;
+    }
+    return count;
+}
+
+std::string DumpToString()
+{
+    std::ostringstream out;
+    Profiler::Dump(out);
+    return out.str();
+}
+}  // namespace
+
+TEST(profiler_test, nothing_recorded_when_stopped)
+{
+    Profiler::Stop();
+    {
+        PROFILE_ZONE("profiler_test_stopped");
+        PROFILE_PLOT("profiler_test_stopped_plot", 1);
+    }
+    EXPECT_EQ(DumpToString().find("profiler_test_stopped"), std::string::npos);
+}
+
+TEST(profiler_test, zones_nest_per_thread)
+{
+    Profiler::Start(64);
+    auto work = []() {
+        PROFILE_ZONE("profiler_test_outer");
+        for (int i = 0; i < 3; i++) {
+            PROFILE_ZONE("profiler_test_inner");
+        }
+    };
+    std::thread other(work);
+    work();
+    other.join();
+    Profiler::Stop();
+
+    auto trace = DumpToString();
+    EXPECT_EQ(CountOf(trace, "\"name\":\"profiler_test_outer\",\"cat\":\"zone\",\"ph\":\"B\""), 2);
+    EXPECT_EQ(CountOf(trace, "\"name\":\"profiler_test_outer\",\"cat\":\"zone\",\"ph\":\"E\""), 2);
+    EXPECT_EQ(CountOf(trace, "\"name\":\"profiler_test_inner\",\"cat\":\"zone\",\"ph\":\"B\""), 6);
+    EXPECT_EQ(CountOf(trace, "\"name\":\"profiler_test_inner\",\"cat\":\"zone\",\"ph\":\"E\""), 6);
+}
+
+TEST(profiler_test, counters_are_summed_over_threads)
+{
+    Profiler::Start(64);
+    PROFILE_PLOT("profiler_test_plot", 7);
+    auto work = []() {
+        for (int i = 0; i < 5; i++) {
+            PROFILE_COUNT("profiler_test_count", 2);
+        }
+    };
+    std::thread other(work);
+    other.join();
+    work();
+    Profiler::Stop();
+
+    auto trace = DumpToString();
+    EXPECT_NE(trace.find("\"name\":\"profiler_test_plot\",\"ph\":\"C\""), std::string::npos);
+    EXPECT_NE(trace.find("\"args\":{\"value\":7.000}"), std::string::npos);
+    EXPECT_EQ(CountOf(trace, "\"name\":\"profiler_test_count\",\"ph\":\"C\""), 10);
+    EXPECT_NE(trace.find("\"args\":{\"value\":20.000}"), std::string::npos);
+}
+
+TEST(profiler_test, ends_without_begins_are_dropped)
+{
+    Profiler::Start(64);
+    std::thread other([]() {
+        PROFILE_ZONE("profiler_test_lost_begin");
+        for (int i = 0; i < 100; i++) {
+            PROFILE_ZONE("profiler_test_overwriter");
+        }
+    });
+    other.join();
+    Profiler::Stop();
+
+    auto trace = DumpToString();
+    EXPECT_EQ(trace.find("profiler_test_lost_begin"), std::string::npos);
+    EXPECT_EQ(CountOf(trace, "\"name\":\"profiler_test_overwriter\",\"cat\":\"zone\",\"ph\":\"B\""),
+              CountOf(trace, "\"name\":\"profiler_test_overwriter\",\"cat\":\"zone\",\"ph\":\"E\""));
+}
@@ -0,0 +1,45 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include <vector>
+#include "utils/chrome_trace.h"
+#include "utils/trace_ring.h"
+
+namespace {
+struct TestEvent {
+    uint64_t id;
+    const char* name;
+    uint32_t type;
+};
+}  // namespace
+
+TEST(trace_ring_test, keeps_the_latest_events)
+{
+    TraceRing<TestEvent> ring(5);
+    EXPECT_EQ(ring.Capacity(), 8);
+    for (uint64_t i = 0; i < 20; i++) {
+        ring.Push({i, "event", static_cast<uint32_t>(i % 3)});
+    }
+
+    std::vector<TestEvent> events;
+    ring.Collect(events);
+    // the slot after the latest one may be half written by the owner, so it is left out
+    ASSERT_EQ(events.size(), 7);
+    for (size_t i = 0; i < events.size(); i++) {
+        EXPECT_EQ(events[i].id, 13 + i);
+        EXPECT_EQ(events[i].type, (13 + i) % 3);
+    }
+}
+
+TEST(trace_ring_test, chrome_trace_frame_and_escape)
+{
+    std::ostringstream out;
+    ChromeTraceWriter trace(out);
+    trace.ThreadName(1, "worker \"0\"");
+    trace.Next() << "{\"name\":\"" << ChromeTraceWriter::Escape(nullptr, "zone") << "\",\"ts\":"
+                 << ChromeTraceWriter::ToUs(1500) << "}";
+    trace.Finish();
+    EXPECT_EQ(out.str(), "{\"traceEvents\":[\n"
+                         "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,"
+                         "\"args\":{\"name\":\"worker \\\"0\\\"\"}},\n"
+                         "{\"name\":\"zone\",\"ts\":1.500}\n]}\n");
+}